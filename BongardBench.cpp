@@ -0,0 +1,163 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "BongardPicture.hpp"
+#include "Configurations.hpp"
+#include "Geometry.hpp"
+#include "RandomEngine.hpp"
+
+namespace {
+
+/**
+ * The number of element pairs checked by default. They fit in the cache, as
+ * the elements of a picture do during the placement.
+ */
+const int kDefaultPairs = 4096;
+
+/** The number of checks timed per kind of check. */
+const long long kChecks = 1 << 24;
+
+/** The number of pictures placed per geometry mode. */
+const int kPictures = 2000;
+
+typedef std::unique_ptr<bongard::BongardElement> element_ptr;
+
+/**
+ * @brief Time \p check over all pairs.
+ *
+ * @return The nanoseconds per check; \p hits is set to the number of pairs
+ *         for which \p check holds.
+ */
+template <typename Check>
+double timeChecks(const std::vector<element_ptr> &first,
+                  const std::vector<element_ptr> &second, Check check,
+                  long long *hits) {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  const long long passes = std::max<long long>(1, kChecks / first.size());
+  long long count = 0;
+  for (long long pass = 0; pass < passes; pass++) {
+    for (size_t i = 0; i < first.size(); i++) {
+      count += check(first[i].get(), second[i].get());
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  *hits = count / passes;
+  return elapsed.count() / passes / first.size();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc > 3) {
+    std::cerr
+        << "Usage: bongard_bench [NUM_PAIRS [BOUND]]\n"
+           "Time the conflict checks of random pairs of elements drawn as "
+           "the generator draws\nthem in a picture of bound BOUND.\n";
+    return 0;
+  }
+  const int num_pairs = argc > 1 ? std::atoi(argv[1]) : kDefaultPairs;
+  const int bound = argc > 2 ? std::atoi(argv[2]) : BOUND;
+  if (num_pairs <= 0 || bound <= 2 * MARGIN) {
+    std::cerr << "Error: invalid arguments.\n";
+    return 1;
+  }
+
+  std::seed_seq seq{num_pairs};
+  bongard::RandomEngine gen(bongard::kEngineMT19937, seq);
+  std::uniform_int_distribution<> coord_rand(MARGIN, bound - MARGIN);
+  std::uniform_int_distribution<> size_rand(2, bound - 2);
+  std::uniform_int_distribution<> type_rand(1, 4);
+  std::vector<element_ptr> first, second;
+  for (int i = 0; i < num_pairs; i++) {
+    for (std::vector<element_ptr> *elems : {&first, &second}) {
+      const int size = size_rand(gen);
+      const int x = coord_rand(gen);
+      const int y = coord_rand(gen);
+      elems->emplace_back(bongard::BongardPicture::createElement(
+          type_rand(gen), x, y, size));
+    }
+  }
+
+  long long box_conflicts, exact_conflicts, shape_conflicts;
+  const double box_ns = timeChecks(
+      first, second,
+      [](const bongard::BongardElement *a, const bongard::BongardElement *b) {
+        return a->conflict(b);
+      },
+      &box_conflicts);
+  const double exact_ns = timeChecks(
+      first, second,
+      [](const bongard::BongardElement *a, const bongard::BongardElement *b) {
+        return a->conflictExact(b);
+      },
+      &exact_conflicts);
+  // The exact tests alone, without the bounding rectangle filter.
+  const double shape_ns = timeChecks(
+      first, second,
+      [](const bongard::BongardElement *a, const bongard::BongardElement *b) {
+        const bongard::shape_geometry ga = a->geometry();
+        const bongard::shape_geometry gb = b->geometry();
+        return !bongard::shapeInside(ga, gb, MARGIN) &&
+               !bongard::shapeInside(gb, ga, MARGIN) &&
+               !bongard::shapeSeparated(ga, gb, MARGIN);
+      },
+      &shape_conflicts);
+  std::cout << "pairs: " << num_pairs << "; bound: " << bound << "\n"
+            << "bounding rectangles: " << box_ns << " ns/check, "
+            << box_conflicts << " conflicts\n"
+            << "exact with filter: " << exact_ns << " ns/check, "
+            << exact_conflicts << " conflicts\n"
+            << "exact without filter: " << shape_ns << " ns/check, "
+            << shape_conflicts << " conflicts\n";
+
+  // The checks as the placement runs them: most drawn elements are rejected
+  // by the picture boundary or by the first conflicting element.
+  for (bool exact : {false, true}) {
+    std::uniform_int_distribution<> num_rand(4, 6);
+    std::uniform_int_distribution<> area_rand(2, bound - 2);
+    bongard::picture_params pp(1, gen, coord_rand, type_rand, area_rand);
+    pp.bound_ = bound;
+    pp.exact_geometry_ = exact;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (int i = 0; i < kPictures; i++) {
+      const int size = num_rand(gen);
+      std::unique_ptr<bongard::BongardPicture> picture;
+      do {
+        picture.reset(new bongard::BongardPicture(pp));
+      } while (!picture->createPicture(size));
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << (exact ? "exact" : "bounding rectangles")
+              << " placement: " << elapsed.count() / pp.stats_.element_trials_
+              << " ns/element trial, " << pp.stats_.element_trials_
+              << " trials for " << kPictures << " pictures\n";
+  }
+  return exact_conflicts == shape_conflicts ? 0 : 1;
+}
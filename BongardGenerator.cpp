@@ -17,65 +17,379 @@
  **/
 
 #include <boost/filesystem.hpp>
+#include <sys/resource.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <iostream>
 #include <memory>
 #include <random>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "BongardGenerator.hpp"
 #include "Configurations.hpp"
+#include "DatasetStats.hpp"
+#include "PrologFile.hpp"
+#include "RelationFile.hpp"
 
 namespace bongard {
 
+namespace {
+
+/**
+ * @brief A relation of a fold.
+ */
+struct relation_file {
+  relation rel_;
+  int num_ids_;
+  /** The number of integer values after the ID columns. */
+  int num_values_;
+};
+
+std::vector<relation_file> foldRelations(const generator_options &opts) {
+  std::vector<relation_file> relations = {
+      {kRelationElement, 2, 0},      {kRelationRectangle, 1, 0},
+      {kRelationCircle, 1, 0},       {kRelationTriangle, 1, 0},
+      {kRelationTriangleUp, 1, 0},   {kRelationTriangleDown, 1, 0},
+      {kRelationInside, 2, 0}};
+
+  // The coordinate encoding replaces the north and east pairs by one
+  // bounding box per element.
+  if (opts.encoding_ == kEncodingPairs) {
+    relations.push_back({kRelationEast, 2, 0});
+    relations.push_back({kRelationNorth, 2, 0});
+  } else {
+    relations.push_back({kRelationBox, 1, 4});
+  }
+
+  if (opts.forest_) {
+    relations.push_back({kRelationDirectlyInside, 2, 0});
+    relations.push_back({kRelationDepth, 1, 1});
+  }
+  return relations;
+}
+
+/**
+ * @return The peak resident set size of the process in KB.
+ */
+long peakRSSKilobytes() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+/**
+ * @return "name/arity" of the predicate of \p r.
+ */
+std::string predicateIndicator(const relation_file &r) {
+  return std::string(relationName(r.rel_)) + "/" +
+         std::to_string(r.num_ids_ + r.num_values_);
+}
+
+/**
+ * @return The arguments of the mode declarations of \p r, one per
+ *         declaration.
+ */
+std::vector<std::string> modeArguments(const relation_file &r) {
+  std::string values;
+  for (int i = 0; i < r.num_values_; i++) values += ",-int";
+  if (r.rel_ == kRelationElement) return {"+picture,-object"};
+  if (r.num_ids_ == 1) return {"+object" + values};
+  return {"+object,-object", "-object,+object"};
+}
+
+}  // namespace
+
 BongardGenerator::BongardGenerator(generator_params p,
                                    const std::string &root_path,
                                    id_type pid,
                                    id_type eid,
-                                   int fold_id)
+                                   int fold_id,
+                                   const generator_options &opts)
     : fold_id_(fold_id),
       root_path_(root_path),
       pid_(pid),
       eid_(eid),
+      buffered_bytes_(0),
+      pending_bytes_(0),
       p_(p),
-      gen_(rd_()) {}
+      opts_(opts),
+      seed_(opts.seeded_ ? opts.seed_
+                         : static_cast<std::uint64_t>(rd_()) << 32 | rd_()),
+      kernel_(NULL),
+      num_pictures_(0),
+      next_claim_(0),
+      next_batch_(0),
+      num_batches_(0),
+      duplicate_run_(0),
+      failed_(false) {}
+
+bool generator_params::feasible(std::string *reason) const {
+  // The number of elements of a picture is drawn from the range, and a
+  // picture of an infeasible number is retried forever.
+  for (int n = min_num_elems_; n <= max_num_elems_; n++) {
+    if (!feasible(n, reason)) return false;
+  }
+  return true;
+}
+
+bool generator_params::feasible(int num_elems, std::string *reason) const {
+  std::ostringstream str;
+  // An element of size s fits iff MARGIN + s < bound_.
+  const int max_fit = std::min(max_size_, bound_ - MARGIN - 1);
+  if (min_size_ > max_fit) {
+    str << "no element of size at least " << min_size_
+        << " fits in a picture of bound " << bound_;
+    *reason = str.str();
+    return false;
+  }
+
+  // An enclosing element is larger than the enclosed one by at least
+  // 2 * MARGIN, so the nesting depth is at most max_depth. By the exact
+  // shapes, a circle is up to one unit smaller than its size.
+  const int step = exact_geometry_ ? 2 * MARGIN - 1 : 2 * MARGIN;
+  const long long max_depth = (max_fit - min_size_) / step;
+  const long long n = num_elems;
+  long long max_insides;
+  if (n <= max_depth + 1) {
+    max_insides = n * (n - 1) / 2;
+  } else {
+    // A chain of max_depth + 1 elements, with the others at the bottom.
+    max_insides = max_depth * (max_depth + 1) / 2 + (n - max_depth - 1) *
+                                                        max_depth;
+  }
+  if (max_insides < min_insides_) {
+    str << "at most " << max_insides << " inside pairs fit in a picture of "
+        << n << " elements of sizes in [" << min_size_ << ", " << max_fit
+        << "], fewer than " << min_insides_;
+    *reason = str.str();
+    return false;
+  }
+
+  // The elements enclosing no other element are pairwise separated, and
+  // there are at least n / (max_depth + 1) of them since every element
+  // encloses one of them or is one of them. Each needs its area plus
+  // the margin around it. The exact shapes are only bounded by the area of
+  // the smallest one, a triangle.
+  const long long leaves = (n + max_depth) / (max_depth + 1);
+  const long long side = min_size_ + MARGIN + 1;
+  const long long space = static_cast<long long>(bound_) + MARGIN + 1;
+  const double area = exact_geometry_
+                          ? std::sqrt(3) / 4 * min_size_ * min_size_
+                          : static_cast<double>(side) * side;
+  if (leaves * area > static_cast<double>(space) * space) {
+    str << leaves << " separated elements of size at least " << min_size_
+        << " do not fit in a picture of bound " << bound_ << " with " << n
+        << " elements";
+    *reason = str.str();
+    return false;
+  }
+  return true;
+}
+
+bool BongardGenerator::generate(id_type num) {
+  ThreadPool pool(opts_.num_threads_);
+  if (!schedule(num, &pool)) return false;
+  pool.wait();
+  return finish();
+}
+
+bool BongardGenerator::schedule(id_type num, ThreadPool *pool) {
+  std::string reason;
+  if (!p_.feasible(&reason)) {
+    std::cerr << "Error: the generator parameters are infeasible: " << reason
+              << ".\n";
+    return false;
+  }
+
+  // The kernels test the bounding rectangles only.
+  if (opts_.kernels_ && !opts_.large_pictures_ && !p_.exact_geometry_) {
+    kernel_ = selectPlacementKernel(p_.bound_, p_.max_num_elems_);
+  }
+
+  std::cout << "To generate " << num << " pictures"
+            << (kernel_ != NULL ? " with a specialized kernel" : "")
+            << ".\n";
 
-void BongardGenerator::generate(id_type num) {
+  id_type num_batches;
+  {
+    // The workers number the batches replacing duplicates under the same
+    // lock, so the batches are numbered before the first one is taken.
+    std::lock_guard<std::mutex> lock(commit_mutex_);
+    num_pictures_ = num > pid_ ? num - pid_ : 0;
+    num_batches_ = (num_pictures_ + BATCH_SIZE - 1) / BATCH_SIZE;
+    num_batches = num_batches_;
+  }
+  const id_type num_workers =
+      std::min<id_type>(pool->size(), num_batches);
+  for (id_type i = 0; i < num_workers; i++) {
+    pool->submit([this]() { runBatches(); });
+  }
+  return true;
+}
+
+void BongardGenerator::runBatches() {
+  id_type batch;
+  id_type count;
+  while (takeBatch(&batch, &count)) generateBatch(batch, count);
+}
+
+bool BongardGenerator::takeBatch(id_type *batch, id_type *count) {
+  // Over the memory budget, a batch is only taken when it is the one commit
+  // waits for, so that the pending batches are drained before more are
+  // generated.
+  std::unique_lock<std::mutex> lock(commit_mutex_);
+  budget_cv_.wait(lock, [this]() {
+    return failed_ || next_claim_ == num_batches_ ||
+           next_claim_ == next_batch_ || opts_.memory_budget_ == 0 ||
+           buffered_bytes_ + pending_bytes_ < opts_.memory_budget_;
+  });
+  if (failed_ || next_claim_ == num_batches_) return false;
+  *batch = next_claim_++;
+  if (*batch * BATCH_SIZE < num_pictures_) {
+    *count = std::min<id_type>(BATCH_SIZE, num_pictures_ - *batch * BATCH_SIZE);
+  } else {
+    std::map<id_type, id_type>::iterator it = replacements_.find(*batch);
+    *count = it->second;
+    replacements_.erase(it);
+  }
+  return true;
+}
+
+void BongardGenerator::generateBatch(id_type batch, id_type count) {
+  if (failed_) return;
+
+  std::seed_seq seq{static_cast<unsigned int>(seed_),
+                    static_cast<unsigned int>(seed_ >> 32),
+                    static_cast<unsigned int>(batch),
+                    static_cast<unsigned int>(batch >> 32)};
+  RandomEngine gen(opts_.engine_, seq);
   std::uniform_int_distribution<> size_dis(p_.min_num_elems_,
                                            p_.max_num_elems_);
   std::uniform_int_distribution<> area_rand(p_.min_size_, p_.max_size_);
-  std::uniform_int_distribution<> coord_rand(MARGIN, BOUND - MARGIN);
+  std::uniform_int_distribution<> coord_rand(MARGIN, p_.bound_ - MARGIN);
   std::uniform_int_distribution<> type_rand(1, 4);
 
-  picture_params pp(p_.min_insides_, gen_, coord_rand, type_rand, area_rand);
-
-  std::cout << "To generate " << num << " pictures.\n";
+  picture_params pp(p_.min_insides_, gen, coord_rand, type_rand, area_rand);
+  pp.bound_ = p_.bound_;
+  pp.sweep_ = opts_.large_pictures_;
+  pp.spatial_index_ = opts_.large_pictures_;
+  pp.exact_geometry_ = p_.exact_geometry_;
+  pp.kernel_ = kernel_;
+  pp.encoding_ = opts_.encoding_;
 
-  while (pid_ < num) {
+  picture_batch pictures;
+  pictures.pictures_.reserve(count);
+  while (pictures.pictures_.size() < count) {
     std::unique_ptr<BongardPicture> picture(new BongardPicture(pp));
-    int size = size_dis(gen_);
+    int size = size_dis(gen);
     int error_try = 0;
+    const id_type trials = pp.stats_.element_trials_;
     while (!picture->createPicture(size)) {
       error_try++;
-      picture.reset(new BongardPicture(pp));
-      if (error_try % 10000 == 0) {
-        std::cout << "Error trials: " << error_try << std::endl;
+      if (failed_) return;
+      if (pp.stats_.element_trials_ - trials > opts_.max_picture_trials_) {
+        std::ostringstream str;
+        str << "gave up a picture of " << size << " elements after "
+            << pp.stats_.element_trials_ - trials << " element trials in "
+            << error_try << " attempts";
+        std::lock_guard<std::mutex> lock(commit_mutex_);
+        stats_.merge(pp.stats_);
+        if (!failed_) failure_ = str.str();
+        failed_ = true;
+        budget_cv_.notify_all();
+        return;
       }
+      picture.reset(new BongardPicture(pp));
+    }
+    if (opts_.dedup_) {
+      pictures.hashes_.push_back(
+          picture->canonicalHash(opts_.dedup_invariance_));
     }
+    pictures.bytes_ += picture->memoryBytes() + sizeof(picture);
+    pictures.pictures_.emplace_back(picture.release());
+  }
 
-    picture->assignIDs(pid_, eid_);
-    pictures_.emplace_back(picture.release());
+  commit(batch, &pictures, pp.stats_);
+}
+
+void BongardGenerator::commit(id_type batch, picture_batch *pictures,
+                              const placement_stats &stats) {
+  std::lock_guard<std::mutex> lock(commit_mutex_);
+  stats_.merge(stats);
+  pending_bytes_ += pictures->bytes_;
+  pending_[batch] = std::move(*pictures);
+
+  std::map<id_type, picture_batch>::iterator it;
+  while ((it = pending_.find(next_batch_)) != pending_.end()) {
+    id_type duplicates = 0;
+    for (size_t i = 0; i < it->second.pictures_.size(); i++) {
+      if (opts_.dedup_ && !opts_.dedup_->insert(it->second.hashes_[i])) {
+        duplicates++;
+        duplicate_run_++;
+        continue;
+      }
+      duplicate_run_ = 0;
 
-    if (pictures_.size() == CUTOFF) {
-      output();
-      pictures_.clear();
+      std::unique_ptr<BongardPicture> &picture = it->second.pictures_[i];
+      picture->assignIDs(pid_, eid_);
+      buffered_bytes_ += picture->memoryBytes() + sizeof(picture);
+      pictures_.emplace_back(picture.release());
+
+      if (opts_.memory_budget_ > 0 ? buffered_bytes_ >= opts_.memory_budget_
+                                   : pictures_.size() == CUTOFF) {
+        output();
+        pictures_.clear();
+        buffered_bytes_ = 0;
+      }
+
+      if (pid_ % (PRINT_GRAN) == 0) {
+        std::cout << "Generated " << pid_ << " pictures.\n" << std::flush;
+      }
     }
+    pending_bytes_ -= it->second.bytes_;
+    pending_.erase(it);
+    next_batch_++;
 
-    if (pid_ % (PRINT_GRAN) == 0) {
-      std::cout << "Generated " << pid_ << " pictures.\n" << std::flush;
+    if (duplicates == 0) continue;
+    stats_.duplicates_ += duplicates;
+    if (duplicate_run_ > MAX_DUPLICATES) {
+      std::ostringstream str;
+      str << "gave up after " << duplicate_run_ << " consecutive duplicates";
+      if (!failed_) failure_ = str.str();
+      failed_ = true;
+      break;
     }
+    // One replacement per batch, numbered in the commit order. It is taken
+    // by the worker committing it, if not by another one.
+    replacements_[num_batches_++] = duplicates;
   }
+  budget_cv_.notify_all();
+}
+
+bool BongardGenerator::finish() {
+  std::lock_guard<std::mutex> lock(commit_mutex_);
   if (!pictures_.empty()) output();
+  pictures_.clear();
+  buffered_bytes_ = 0;
+  pending_.clear();
+  pending_bytes_ = 0;
+
+  if (failed_) {
+    std::cerr << "Error: " << failure_ << ".\nStatistics: "
+              << stats_.string() << ".\n";
+    return false;
+  }
+  std::cout << "Statistics: " << stats_.string() << ".\n";
+  return true;
 }
 
 void BongardGenerator::output() {
@@ -88,50 +402,175 @@ void BongardGenerator::output() {
     std::cout << "Created directory " << dir.string() << "." << std::endl;
   }
 
-  const std::string elem_rel = "element";
-  const std::string circle_rel = "circle";
-  const std::string rec_rel = "rectangle";
-  const std::string tri_rel = "triangle";
-  const std::string tri_down_rel = "triangle_down";
-  const std::string tri_up_rel = "triangle_up";
-  const std::string east_rel = "east";
-  const std::string north_rel = "north";
-  const std::string inside = "inside";
-
-  FILE *elem_file = fopen((dir / elem_rel).c_str(), "w");
-  FILE *rect_file = fopen((dir / rec_rel).c_str(), "w");
-  FILE *circle_file = fopen((dir / circle_rel).c_str(), "w");
-  FILE *tri_file = fopen((dir / tri_rel).c_str(), "w");
-  FILE *tri_up_file = fopen((dir / tri_up_rel).c_str(), "w");
-  FILE *tri_down_file = fopen((dir / tri_down_rel).c_str(), "w");
-  FILE *east_file = fopen((dir / east_rel).c_str(), "w");
-  FILE *north_file = fopen((dir / north_rel).c_str(), "w");
-  FILE *inside_file = fopen((dir / inside).c_str(), "w");
+  if (opts_.sorted_) {
+    for (const std::unique_ptr<BongardPicture> &picture : pictures_) {
+      picture->sortRelations();
+    }
+  }
+  if (opts_.layout_ & kLayoutText) outputText(dir);
+  if (opts_.layout_ & kLayoutCSR) outputCSR(dir);
+  if (opts_.layout_ & kLayoutProlog) outputProlog(dir);
 
+  DatasetStats stats;
   for (const std::unique_ptr<BongardPicture> &picture : pictures_) {
-    picture->output(elem_file, circle_file, rect_file, tri_file, tri_up_file,
-                    tri_down_file, inside_file, north_file, east_file);
+    picture->collectStats(&stats);
   }
 
   FILE *summary = fopen((dir / "summary").c_str(), "w");
   fprintf(summary,
           "#elements: [%d, %d]; #size: [%d, %d]; #min_insides: %d; "
-          "max_pid: %llu max_eid: %llu\n",
+          "#bound: %d; #geometry: %s; #encoding: %s; max_pid: %llu "
+          "max_eid: %llu fold_bytes: %llu peak_rss_kb: %ld seed: %llu "
+          "rng: %s\n",
           p_.min_num_elems_, p_.max_num_elems_, p_.min_size_, p_.max_size_,
-          p_.min_insides_, pid_, eid_);
+          p_.min_insides_, p_.bound_,
+          p_.exact_geometry_ ? "exact" : "boxes",
+          opts_.encoding_ == kEncodingPairs ? "pairs" : "coordinates", pid_,
+          eid_, buffered_bytes_, peakRSSKilobytes(),
+          static_cast<unsigned long long>(seed_), engineName(opts_.engine_));
+
+  FILE *stats_file = fopen((dir / "stats").c_str(), "w");
+  stats.output(stats_file);
 
   std::cout << "Output " << pictures_.size() << " pictures." << std::endl;
 
+  fclose(stats_file);
   fclose(summary);
-  fclose(elem_file);
-  fclose(rect_file);
-  fclose(circle_file);
-  fclose(tri_file);
-  fclose(tri_up_file);
-  fclose(tri_down_file);
-  fclose(east_file);
-  fclose(north_file);
-  fclose(inside_file);
+}
+
+void BongardGenerator::outputText(const boost::filesystem::path &dir) {
+  const std::vector<relation_file> relations = foldRelations(opts_);
+
+  std::vector<std::unique_ptr<RelationFile>> owners;
+  std::vector<RelationFile *> files;
+  for (const relation_file &r : relations) {
+    owners.emplace_back(
+        new RelationFile(dir, relationName(r.rel_), r.num_ids_, opts_.io_));
+    files.push_back(owners.back().get());
+  }
+
+  // Every relation file has its own writer, which walks all the pictures of
+  // the fold; the pictures are not modified until the writers are joined.
+  std::vector<std::thread> writers;
+  for (size_t i = 0; i < relations.size(); i++) {
+    const relation rel = relations[i].rel_;
+    RelationFile *file = files[i];
+    writers.emplace_back([this, rel, file]() {
+      for (const std::unique_ptr<BongardPicture> &picture : pictures_) {
+        picture->output(rel, file);
+      }
+      file->close();
+    });
+  }
+  for (std::thread &writer : writers) writer.join();
+
+  if (opts_.sorted_) writeZoneMaps(dir, files);
+}
+
+void BongardGenerator::outputProlog(const boost::filesystem::path &dir) {
+  const std::vector<relation_file> relations = foldRelations(opts_);
+
+  std::string indicators;
+  for (const relation_file &r : relations) {
+    indicators += (indicators.empty() ? "" : ", ") + predicateIndicator(r);
+  }
+
+  // With the coordinate encoding, north and east are derived from the boxes
+  // by rules, so that they can still be learned.
+  std::vector<relation_file> predicates = relations;
+  if (opts_.encoding_ == kEncodingCoordinates) {
+    predicates.push_back({kRelationEast, 2, 0});
+    predicates.push_back({kRelationNorth, 2, 0});
+  }
+
+  const int num_shards = std::max(opts_.prolog_shards_, 1);
+  FILE *background = fopen((dir / "bongard.b").c_str(), "w");
+  fprintf(background, ":- modeh(1,bongard(+picture)).\n");
+  for (const relation_file &r : predicates) {
+    for (const std::string &args : modeArguments(r)) {
+      fprintf(background, ":- modeb(%s,%s(%s)).\n",
+              r.num_ids_ == 2 ? "*" : "1", relationName(r.rel_),
+              args.c_str());
+    }
+  }
+  for (const relation_file &r : predicates) {
+    fprintf(background, ":- determination(bongard/1,%s).\n",
+            predicateIndicator(r).c_str());
+  }
+  fprintf(background, ":- [");
+  for (int i = 0; i < num_shards; i++) {
+    fprintf(background, "%s'bk_%d.pl'", i == 0 ? "" : ",", i);
+  }
+  fprintf(background, "].\n");
+  if (opts_.encoding_ == kEncodingCoordinates) {
+    // An element is on the east (north) of another element of its picture
+    // iff its left (bottom) is greater than the right (top) of the other.
+    fprintf(background,
+            "east(A,B) :- element(P,A), element(P,B), box(A,LA,_,_,_), "
+            "box(B,_,_,RB,_), LA > RB.\n"
+            "north(A,B) :- element(P,A), element(P,B), box(A,_,BA,_,_), "
+            "box(B,_,_,_,TB), BA > TB.\n");
+  }
+  fclose(background);
+
+  // The shards hold consecutive pictures. A predicate may have no fact in a
+  // shard, or in the fold, so every shard declares all of them.
+  std::vector<std::thread> writers;
+  for (int i = 0; i < num_shards; i++) {
+    const size_t first = pictures_.size() * i / num_shards;
+    const size_t last = pictures_.size() * (i + 1) / num_shards;
+    const boost::filesystem::path path =
+        dir / ("bk_" + std::to_string(i) + ".pl");
+    writers.emplace_back([this, &relations, &indicators, first, last, path]() {
+      PrologFile file(path, opts_.io_);
+      file.writeLine(":- multifile " + indicators + ".");
+      file.writeLine(":- dynamic " + indicators + ".");
+      for (const relation_file &r : relations) {
+        file.setPredicate(relationName(r.rel_), r.rel_ == kRelationElement);
+        for (size_t j = first; j < last; j++) {
+          pictures_[j]->output(r.rel_, &file);
+        }
+      }
+      file.close();
+    });
+  }
+
+  PrologFile examples(dir / "examples.pl", opts_.io_);
+  examples.setPredicate("bongard", true);
+  for (const std::unique_ptr<BongardPicture> &picture : pictures_) {
+    examples.write(picture->id_);
+  }
+  examples.close();
+
+  for (std::thread &writer : writers) writer.join();
+}
+
+void BongardGenerator::outputCSR(const boost::filesystem::path &dir) {
+  FILE *csr_file = fopen((dir / "picture.csr").c_str(), "wb");
+  FILE *index_file = fopen((dir / "picture.csr_index").c_str(), "wb");
+
+  // The index starts with the first picture id and the number of pictures,
+  // followed by the byte offset of every record and the total file size, so
+  // that the record of picture pid is at offsets[pid - first_pid].
+  uint64_t header[2] = {pictures_.empty() ? 0 : pictures_.front()->id_,
+                        pictures_.size()};
+  fwrite(header, sizeof(uint64_t), 2, index_file);
+
+  std::vector<uint64_t> offsets;
+  offsets.reserve(pictures_.size() + 1);
+  std::vector<char> record;
+  uint64_t offset = 0;
+  for (const std::unique_ptr<BongardPicture> &picture : pictures_) {
+    offsets.push_back(offset);
+    picture->outputCSR(&record);
+    fwrite(record.data(), 1, record.size(), csr_file);
+    offset += record.size();
+  }
+  offsets.push_back(offset);
+  fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), index_file);
+
+  fclose(index_file);
+  fclose(csr_file);
 }
 
 }  // namespace bongard
@@ -20,13 +20,22 @@
 #define BONGARD_GENERATOR_HPP_
 
 #include <boost/filesystem.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <fstream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "BongardPicture.hpp"
+#include "DuplicateFilter.hpp"
+#include "RandomEngine.hpp"
+#include "ThreadPool.hpp"
 
 namespace bongard {
 
@@ -43,20 +52,154 @@ struct generator_params {
    * @param max_size	The maximum size of an element.
    * @param min_insides	The minimum number of pairs of elements for which one
    *                    is enclosed in the other.
+   * @param bound The length and the width of a picture.
+   * @param exact_geometry Test the conflict and the inside relation of
+   *                       elements by their exact shapes.
    */
   generator_params(int min_num_elems, int max_num_elems, int min_size,
-                   int max_size, int min_insides)
+                   int max_size, int min_insides, int bound = BOUND,
+                   bool exact_geometry = false)
       : min_num_elems_(min_num_elems),
         max_num_elems_(max_num_elems),
         min_size_(min_size),
         max_size_(max_size),
-        min_insides_(min_insides) {}
+        min_insides_(min_insides),
+        bound_(bound),
+        exact_geometry_(exact_geometry) {}
 
   const int min_num_elems_;
   const int max_num_elems_;
   const int min_size_;
   const int max_size_;
   const int min_insides_;
+  const int bound_;
+  const bool exact_geometry_;
+
+  /**
+   * @brief Check the necessary conditions below for every number of
+   *        elements in [min_num_elems_, max_num_elems_].
+   *
+   * @param reason Set to the violated condition.
+   * @return False if the pictures of some number of elements can never be
+   *         generated with these parameters.
+   */
+  bool feasible(std::string *reason) const;
+
+  /**
+   * @brief Check necessary conditions for generating a picture of
+   *        \p num_elems elements: an element fits in the picture,
+   *        min_insides_ pairs can be nested, and the elements fit.
+   *
+   * @param reason Set to the violated condition.
+   * @return False if no such picture can be generated.
+   */
+  bool feasible(int num_elems, std::string *reason) const;
+};
+
+/**
+ * @brief The output layouts of a fold, combined as a bit mask.
+ */
+enum output_layout {
+  /** One '|'-separated text file per relation. */
+  kLayoutText = 1,
+  /** One contiguous binary record per picture, see BongardPicture::outputCSR. */
+  kLayoutCSR = 2,
+  /**
+   * Prolog facts, mode declarations and examples for Aleph, see
+   * BongardGenerator::outputProlog.
+   */
+  kLayoutProlog = 4
+};
+
+/**
+ * @brief The generator options that do not affect how a picture is drawn,
+ *        except for the random engine and its seed.
+ */
+struct generator_options {
+  generator_options()
+      : layout_(kLayoutText),
+        large_pictures_(false),
+        encoding_(kEncodingPairs),
+        forest_(false),
+        kernels_(true),
+        max_picture_trials_(MAX_PICTURE_TRY),
+        num_threads_(std::max(1u, std::thread::hardware_concurrency())),
+        sorted_(false),
+        dedup_invariance_(kInvariantNone),
+        io_(kIOBuffered),
+        prolog_shards_(1),
+        memory_budget_(0),
+        seeded_(false),
+        seed_(0),
+        engine_(kEngineMT19937) {}
+
+  /** A bit mask of output_layout. */
+  int layout_;
+
+  /**
+   * Compute the relations with sort-and-sweep and index the elements of a
+   * picture, see picture_params::sweep_ and picture_params::spatial_index_.
+   */
+  bool large_pictures_;
+
+  /** The encoding of the north and east relations. */
+  relation_encoding encoding_;
+
+  /**
+   * Also output the containment forest: the directly_inside relation and
+   * the nesting depth of every element.
+   */
+  bool forest_;
+
+  /**
+   * Use the placement kernel precompiled for the picture bound and the
+   * maximum number of elements, if there is one.
+   */
+  bool kernels_;
+
+  /**
+   * The number of element trials after which the generation of a picture,
+   * and of the dataset, fails.
+   */
+  id_type max_picture_trials_;
+
+  /** The number of threads of the pool created by generate(). */
+  int num_threads_;
+
+  /**
+   * Order the relations of a fold by their ID columns and write the zone
+   * maps of the relation files, see writeZoneMaps.
+   */
+  bool sorted_;
+
+  /**
+   * If not NULL, the pictures whose canonical hash is already in the filter
+   * are dropped and drawn again. Every configuration of a sweep has its
+   * own, see sweep_config::dedup_.
+   */
+  std::shared_ptr<DuplicateFilter> dedup_;
+
+  /** A bit mask of hash_invariance for the canonical hashes. */
+  int dedup_invariance_;
+
+  /** How the relation files of the text and Prolog layouts are written. */
+  io_mode io_;
+
+  /** The number of files the facts of a fold are split into. */
+  int prolog_shards_;
+
+  /**
+   * If not 0, a fold is written when its pictures hold this number of bytes,
+   * instead of when it has CUTOFF pictures.
+   */
+  id_type memory_budget_;
+
+  /** If false, the seed is drawn from std::random_device. */
+  bool seeded_;
+  std::uint64_t seed_;
+
+  /** The random engine of the batches. */
+  engine_type engine_;
 };
 
 /**
@@ -72,12 +215,14 @@ class BongardGenerator {
    * @param pid	The starting picture id.
    * @param eid	the starting picture element id.
    * @param fold_id	The starting fold id.
+   * @param opts Generator options.
    */
   BongardGenerator(generator_params p,
                    const std::string &root_path,
                    id_type pid = 0,
                    id_type eid = 0,
-                   int fold_id = 0);
+                   int fold_id = 0,
+                   const generator_options &opts = generator_options());
 
   /**
    * @brief Randomly generate pictures
@@ -91,11 +236,79 @@ class BongardGenerator {
    *          box of the picture.
    *
    * @param num The number of pictures to be generated.
+   * @return False if the parameters are infeasible or a picture cannot be
+   *         generated in max_picture_trials_ element trials.
    */
-  void generate(id_type num);
+  bool generate(id_type num);
+
+  /**
+   * @brief Submit the generation of pictures to a (shared) thread pool.
+   * @details The pictures are generated in batches of BATCH_SIZE by one
+   *          task per worker of the pool, which takes the lowest batch not
+   *          taken yet until there is none. Completed batches are committed
+   *          in order: the pictures get their IDs and full folds are written
+   *          by the thread that commits them.
+   *
+   * @param num The number of pictures to be generated.
+   * @param pool The pool running the batches.
+   * @return False if the parameters are infeasible.
+   */
+  bool schedule(id_type num, ThreadPool *pool);
+
+  /**
+   * @brief Write the last fold once the scheduled batches have finished.
+   * @return False if a picture could not be generated.
+   */
+  bool finish();
 
  private:
+  struct picture_batch {
+    picture_batch() : bytes_(0) {}
+
+    std::vector<std::unique_ptr<BongardPicture>> pictures_;
+    /** The canonical hashes of the pictures, if duplicates are dropped. */
+    std::vector<std::uint64_t> hashes_;
+    /** The bytes held by the pictures, see BongardPicture::memoryBytes. */
+    id_type bytes_;
+  };
+
+  /**
+   * @brief Generate batches until there is none left to take.
+   */
+  void runBatches();
+
+  /**
+   * @brief Take the lowest batch not taken yet. Over the memory budget,
+   *        wait until it is the batch commit waits for.
+   * @return False if every batch is taken or the generation failed.
+   */
+  bool takeBatch(id_type *batch, id_type *count);
+
+  void generateBatch(id_type batch, id_type count);
+
+  /**
+   * @brief Commit the batches in order. The duplicates are dropped here, so
+   *        that the same pictures are dropped in every run, and drawn again
+   *        by a new batch.
+   */
+  void commit(id_type batch, picture_batch *pictures,
+              const placement_stats &stats);
+
   void output();
+  void outputText(const boost::filesystem::path &dir);
+  void outputCSR(const boost::filesystem::path &dir);
+
+  /**
+   * @brief Write the fold for Aleph.
+   * @details 'bongard.b' holds the mode declarations and the determinations,
+   *          and loads the facts of the relations, which are split by picture
+   *          into the shards 'bk_<i>.pl'. 'examples.pl' gives the example
+   *          bongard(p<ID>) of every picture, to be split into positive and
+   *          negative examples. Every shard is written by its own thread.
+   *          With kEncodingCoordinates, 'bongard.b' also defines north and
+   *          east by rules on the boxes.
+   */
+  void outputProlog(const boost::filesystem::path &dir);
 
   int fold_id_;
   boost::filesystem::path root_path_;
@@ -103,10 +316,38 @@ class BongardGenerator {
   id_type eid_;
 
   std::vector<std::unique_ptr<BongardPicture>> pictures_;
+  /** The bytes held by pictures_, see BongardPicture::memoryBytes. */
+  id_type buffered_bytes_;
+  /** The bytes held by the batches in pending_. */
+  id_type pending_bytes_;
 
   generator_params p_;
+  generator_options opts_;
   std::random_device rd_;
-  std::mt19937 gen_;
+  /** The seed of the random engines of the batches. */
+  std::uint64_t seed_;
+  placement_kernel kernel_;
+
+  /** Guards the members below, pictures_, the byte counts and the IDs. */
+  std::mutex commit_mutex_;
+  /** Signalled when batches are drained or the generation fails. */
+  std::condition_variable budget_cv_;
+  /** The number of pictures of the batches before the replacements. */
+  id_type num_pictures_;
+  /** The next batch to take, see takeBatch. */
+  id_type next_claim_;
+  /** The number of pictures of the replacement batches not taken yet. */
+  std::map<id_type, id_type> replacements_;
+  /** The completed batches waiting for the batches before them. */
+  std::map<id_type, picture_batch> pending_;
+  id_type next_batch_;
+  /** The number of the next batch replacing duplicates. */
+  id_type num_batches_;
+  /** The number of consecutive duplicates. */
+  id_type duplicate_run_;
+  placement_stats stats_;
+  std::string failure_;
+  std::atomic<bool> failed_;
 };
 
 }  // namespace bongard
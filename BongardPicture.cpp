@@ -16,22 +16,117 @@
  * @author Qiang Zeng <qzeng@cs.wisc.edu>
  **/
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <functional>
+#include <map>
 #include <memory>
 #include <iostream>
+#include <queue>
 #include <sstream>
 #include <string>
 
 #include "BongardPicture.hpp"
+#include "DatasetStats.hpp"
+#include "DuplicateFilter.hpp"
 
 namespace bongard {
 
-BongardPicture::BongardPicture(picture_params p) : p_(p), id_(-1) {}
+void placement_stats::merge(const placement_stats &other) {
+  pictures_ += other.pictures_;
+  picture_trials_ += other.picture_trials_;
+  element_trials_ += other.element_trials_;
+  element_failures_ += other.element_failures_;
+  rollbacks_ += other.rollbacks_;
+  inside_shortfalls_ += other.inside_shortfalls_;
+  duplicates_ += other.duplicates_;
+}
+
+std::string placement_stats::string() const {
+  std::ostringstream str;
+  str << "pictures: " << pictures_ << "; picture trials: " << picture_trials_
+      << "; element trials: " << element_trials_
+      << "; exhausted element budgets: " << element_failures_
+      << "; rollbacks: " << rollbacks_
+      << "; pictures short of insides: " << inside_shortfalls_
+      << "; duplicates: " << duplicates_;
+  return str.str();
+}
+
+const char *shapeName(ShapeType shape) {
+  switch (shape) {
+    case kSquare:
+      return "rectangle";
+    case kCircle:
+      return "circle";
+    case kTriangleUp:
+      return "triangle_up";
+    case kTriangleDown:
+      return "triangle_down";
+    default:
+      return "unknown";
+  }
+}
+
+const char *relationName(relation rel) {
+  switch (rel) {
+    case kRelationElement:
+      return "element";
+    case kRelationRectangle:
+      return "rectangle";
+    case kRelationCircle:
+      return "circle";
+    case kRelationTriangle:
+      return "triangle";
+    case kRelationTriangleUp:
+      return "triangle_up";
+    case kRelationTriangleDown:
+      return "triangle_down";
+    case kRelationInside:
+      return "inside";
+    case kRelationNorth:
+      return "north";
+    case kRelationEast:
+      return "east";
+    case kRelationBox:
+      return "box";
+    case kRelationDirectlyInside:
+      return "directly_inside";
+    case kRelationDepth:
+      return "depth";
+    default:
+      return "unknown";
+  }
+}
+
+BongardPicture::BongardPicture(picture_params &p)
+    : p_(p), encoding_(p.encoding_), bound_(p.bound_), id_(-1) {
+  if (p_.spatial_index_) {
+    grid_.reset(new SpatialGrid(p_.size_dist_.max() + MARGIN));
+  }
+}
 
 bool BongardPicture::isValid(BongardElement *check) const {
-  if (check->overflow()) {
+  if (check->overflow(p_.bound_)) {
     return false;
   }
+  if (grid_) {
+    const bool exact = p_.exact_geometry_;
+    return !grid_->anyCandidate(check, MARGIN,
+                                [check, exact](const BongardElement *elem) {
+                                  return exact ? elem->conflictExact(check)
+                                               : elem->conflict(check);
+                                });
+  }
+  if (p_.exact_geometry_) {
+    for (const std::unique_ptr<BongardElement> &elem : elems_) {
+      if (elem->conflictExact(check)) {
+        return false;
+      }
+    }
+    return true;
+  }
   for (const std::unique_ptr<BongardElement> &elem : elems_) {
     if (elem->conflict(check)) {
       return false;
@@ -45,7 +140,11 @@ BongardElement *BongardPicture::createElement() {
   int x = p_.coord_dist_(p_.gen_);
   int y = p_.coord_dist_(p_.gen_);
   int fig = p_.type_dist_(p_.gen_);
+  return createElement(fig, x, y, size);
+}
 
+BongardElement *BongardPicture::createElement(int fig, int x, int y,
+                                              int size) {
   if (fig == 1) return new BongardSquare(x, y, size);
   if (fig == 2) return new BongardCircle(x, y, size);
   if (fig == 3) return new BongardTriangle(x, y, size, 0);
@@ -55,36 +154,103 @@ BongardElement *BongardPicture::createElement() {
 }
 
 bool BongardPicture::createPicture(unsigned size) {
+  p_.stats_.picture_trials_++;
+
+  // With a kernel, the elements are kept as specs and only created once the
+  // placement succeeds.
+  std::vector<element_spec> specs;
+  long long budget = MIN_TRY;
+  int rollbacks = 0;
+  while (true) {
+    bool placed;
+    if (p_.kernel_ != NULL) {
+      placed = p_.kernel_(p_, size, budget, &specs);
+      if (placed) {
+        elems_.clear();
+        for (const element_spec &spec : specs) {
+          elems_.emplace_back(
+              createElement(spec.fig_, spec.x_, spec.y_, spec.size_));
+        }
+      }
+    } else {
+      placed = placeElements(size, budget);
+    }
+
+    if (placed) {
+      populate();
+      if (static_cast<int>(inside_.size()) >= p_.min_insides_) {
+        p_.stats_.pictures_++;
+        grid_.reset();
+        return true;
+      }
+      p_.stats_.inside_shortfalls_++;
+    } else {
+      p_.stats_.element_failures_++;
+      if (budget >= MAX_TRY) {
+        return false;
+      }
+      budget = std::min<long long>(budget * 2, MAX_TRY);
+    }
+
+    if (++rollbacks > MAX_ROLLBACKS) {
+      return false;
+    }
+    p_.stats_.rollbacks_++;
+    if (p_.kernel_ != NULL) {
+      if (!specs.empty()) specs.pop_back();
+    } else {
+      rollback();
+    }
+  }
+}
+
+bool BongardPicture::placeElements(unsigned size, long long budget) {
   while (elems_.size() < size) {
-    int error_trial = 0;
+    long long error_trial = 0;
     while (true) {
+      p_.stats_.element_trials_++;
       std::unique_ptr<BongardElement> elem(createElement());
       if (isValid(elem.get())) {
+        if (grid_) grid_->insert(elem.get());
         elems_.emplace_back(elem.release());
         break;
       } else {
         error_trial++;
-        if (error_trial > MAX_TRY) {
+        if (error_trial > budget) {
           return false;
         }
       }
     }
   }
+  return true;
+}
 
-  populate();
-  return inside_.size() >= p_.min_insides_;
+void BongardPicture::rollback() {
+  if (elems_.empty()) return;
+  if (grid_) grid_->remove(elems_.back().get());
+  elems_.pop_back();
 }
 
 void BongardPicture::populate() {
+  inside_.clear();
+  north_.clear();
+  east_.clear();
+  buildForest();
+  if (p_.sweep_) {
+    populateSweep();
+    return;
+  }
+
+  const bool pairs = p_.encoding_ == kEncodingPairs;
   for (size_t i = 0; i < elems_.size(); i++) {
     BongardElement *elem1 = elems_[i].get();
     for (size_t j = i + 1; j < elems_.size(); j++) {
       BongardElement *elem2 = elems_[j].get();
-      if (elem1->isInside(elem2)) {
+      if (isInside(elem1, elem2)) {
         inside_.emplace_back(elem1, elem2);
-      } else if (elem2->isInside(elem1)) {
+      } else if (isInside(elem2, elem1)) {
         inside_.emplace_back(elem2, elem1);
-      } else {
+      } else if (pairs) {
         if (elem1->isEastOf(elem2)) {
           east_.emplace_back(elem1, elem2);
         } else if (elem2->isEastOf(elem1)) {
@@ -93,7 +259,7 @@ void BongardPicture::populate() {
 
         if (elem1->isNorthOf(elem2)) {
           north_.emplace_back(elem1, elem2);
-        } else {
+        } else if (elem2->isNorthOf(elem1)) {
           north_.emplace_back(elem2, elem1);
         }
       }
@@ -101,12 +267,223 @@ void BongardPicture::populate() {
   }
 }
 
+namespace {
+
+/**
+ * @brief Emit (a, b) for every pair in which the low coordinate of a is
+ *        greater than the high coordinate of b.
+ * @details The elements are sorted by the high coordinate once, so that the
+ *          second elements of every first element form a prefix of the order.
+ */
+template <typename Low, typename High>
+void sweepPairs(
+    const std::vector<BongardElement *> &elems, Low low, High high,
+    std::vector<std::pair<BongardElement *, BongardElement *>> *pairs) {
+  std::vector<BongardElement *> by_high(elems);
+  std::sort(by_high.begin(), by_high.end(),
+            [&](const BongardElement *a, const BongardElement *b) {
+              return high(a) < high(b);
+            });
+  for (BongardElement *a : elems) {
+    const int lo = low(a);
+    for (BongardElement *b : by_high) {
+      if (high(b) >= lo) break;
+      pairs->emplace_back(a, b);
+    }
+  }
+}
+
+}  // namespace
+
+bool BongardPicture::isInside(const BongardElement *a,
+                              const BongardElement *b) const {
+  if (!p_.exact_geometry_) return a->isInside(b);
+  for (const BongardElement *anc = a->parent_; anc != NULL;
+       anc = anc->parent_) {
+    if (anc == b) return true;
+  }
+  return false;
+}
+
+void BongardPicture::buildForest() {
+  if (p_.exact_geometry_) {
+    buildForestExact();
+    return;
+  }
+
+  std::vector<BongardElement *> by_left;
+  by_left.reserve(elems_.size());
+  for (const std::unique_ptr<BongardElement> &e : elems_) {
+    e->parent_ = NULL;
+    e->children_.clear();
+    e->depth_ = 0;
+    by_left.push_back(e.get());
+  }
+  // An enclosing box starts strictly before the boxes it encloses, and
+  // enclosing boxes are larger, so ties are broken by the area.
+  std::sort(by_left.begin(), by_left.end(),
+            [](const BongardElement *a, const BongardElement *b) {
+              const Rectangle &ra = a->getOuterBoundRect();
+              const Rectangle &rb = b->getOuterBoundRect();
+              if (ra.getLeftBottom().x_ != rb.getLeftBottom().x_) {
+                return ra.getLeftBottom().x_ < rb.getLeftBottom().x_;
+              }
+              return ra.area() > rb.area();
+            });
+
+  // The boxes crossing the sweep line, keyed by their bottom side, and the
+  // same boxes ordered by their right side for expiration.
+  std::map<int, BongardElement *> active;
+  typedef std::pair<int, BongardElement *> expiration;
+  std::priority_queue<expiration, std::vector<expiration>,
+                      std::greater<expiration>> expirations;
+
+  for (BongardElement *elem : by_left) {
+    const Rectangle &rect = elem->getOuterBoundRect();
+    while (!expirations.empty() &&
+           expirations.top().first < rect.getLeftBottom().x_) {
+      BongardElement *expired = expirations.top().second;
+      active.erase(expired->getOuterBoundRect().getLeftBottom().y_);
+      expirations.pop();
+    }
+
+    BongardElement *parent = NULL;
+    std::map<int, BongardElement *>::iterator it =
+        active.upper_bound(rect.getLeftBottom().y_);
+    if (it != active.begin()) {
+      parent = (--it)->second;
+      while (parent != NULL && !elem->isInside(parent)) {
+        parent = parent->parent_;
+      }
+    }
+    if (parent != NULL) {
+      elem->parent_ = parent;
+      elem->depth_ = parent->depth_ + 1;
+      parent->children_.push_back(elem);
+    }
+
+    active[rect.getLeftBottom().y_] = elem;
+    expirations.emplace(rect.getRightTop().x_, elem);
+  }
+}
+
+void BongardPicture::buildForestExact() {
+  for (const std::unique_ptr<BongardElement> &e : elems_) {
+    e->parent_ = NULL;
+    e->children_.clear();
+    e->depth_ = 0;
+  }
+
+  // depth_ counts the enclosing elements first.
+  std::vector<std::vector<BongardElement *>> enclosing(elems_.size());
+  for (size_t i = 0; i < elems_.size(); i++) {
+    BongardElement *elem1 = elems_[i].get();
+    for (size_t j = i + 1; j < elems_.size(); j++) {
+      BongardElement *elem2 = elems_[j].get();
+      if (elem1->isInsideExact(elem2)) {
+        enclosing[i].push_back(elem2);
+        elem1->depth_++;
+      } else if (elem2->isInsideExact(elem1)) {
+        enclosing[j].push_back(elem1);
+        elem2->depth_++;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < elems_.size(); i++) {
+    BongardElement *elem = elems_[i].get();
+    for (BongardElement *anc : enclosing[i]) {
+      if (anc->depth_ == elem->depth_ - 1) {
+        elem->parent_ = anc;
+        anc->children_.push_back(elem);
+        break;
+      }
+    }
+  }
+}
+
+void BongardPicture::populateSweep() {
+  std::vector<BongardElement *> elems;
+  elems.reserve(elems_.size());
+  for (const std::unique_ptr<BongardElement> &e : elems_) {
+    elems.push_back(e.get());
+  }
+
+  // The inside relation is the transitive closure of the forest.
+  for (BongardElement *elem : elems) {
+    for (BongardElement *anc = elem->parent_; anc != NULL;
+         anc = anc->parent_) {
+      inside_.emplace_back(elem, anc);
+    }
+  }
+
+  if (p_.encoding_ != kEncodingPairs) return;
+
+  // Nested elements are never on the east or north of each other, so the
+  // sweeps need not exclude the inside pairs.
+  sweepPairs(elems,
+             [](const BongardElement *e) {
+               return e->getOuterBoundRect().getLeftBottom().x_;
+             },
+             [](const BongardElement *e) {
+               return e->getOuterBoundRect().getRightTop().x_;
+             },
+             &east_);
+  sweepPairs(elems,
+             [](const BongardElement *e) {
+               return e->getOuterBoundRect().getLeftBottom().y_;
+             },
+             [](const BongardElement *e) {
+               return e->getOuterBoundRect().getRightTop().y_;
+             },
+             &north_);
+}
+
 bool BongardElement::conflict(const BongardElement *other) const {
   if (isInside(other)) return false;
   if (isInside(other)) return false;
   return isOverlapped(other);
 }
 
+bool BongardElement::conflictExact(const BongardElement *other) const {
+  const Rectangle &outer = getOuterBoundRect();
+  const Rectangle &other_outer = other->getOuterBoundRect();
+  // The shapes are within their outer rectangles.
+  if (!outer.isOverlapped(other_outer)) return false;
+  // The inner rectangles are rounded to integers, by less than one unit.
+  const Rectangle &inner = getInnerBoundRect();
+  const Rectangle &other_inner = other->getInnerBoundRect();
+  if (outer.isInside(other_inner, MARGIN + 1) ||
+      other_outer.isInside(inner, MARGIN + 1)) {
+    return false;
+  }
+  // Then intersecting inner rectangles make the shapes intersect, and the
+  // shapes conflict unless one is nested in the other. The left and bottom
+  // sides of the outer rectangles touch the shapes, so a nested shape has
+  // its left-bottom corner inside of the other's.
+  if (inner.isOverlapped(other_inner, -2)) {
+    const Point &lb = outer.getLeftBottom();
+    const Point &other_lb = other_outer.getLeftBottom();
+    const bool may_nest =
+        (lb.x_ >= other_lb.x_ + MARGIN && lb.y_ >= other_lb.y_ + MARGIN) ||
+        (other_lb.x_ >= lb.x_ + MARGIN && other_lb.y_ >= lb.y_ + MARGIN);
+    if (!may_nest) return true;
+  }
+
+  const shape_geometry shape = geometry();
+  const shape_geometry other_shape = other->geometry();
+  return !shapeSeparated(shape, other_shape, MARGIN) &&
+         !shapeInside(shape, other_shape, MARGIN) &&
+         !shapeInside(other_shape, shape, MARGIN);
+}
+
+bool BongardElement::isInsideExact(const BongardElement *other) const {
+  const Rectangle &outer = getOuterBoundRect();
+  if (!outer.isOverlapped(other->getOuterBoundRect())) return false;
+  if (outer.isInside(other->getInnerBoundRect(), MARGIN + 1)) return true;
+  return shapeInside(geometry(), other->geometry(), MARGIN);
+}
+
 bool BongardElement::isOverlapped(const BongardElement *other) const {
   return getOuterBoundRect().isOverlapped(other->getOuterBoundRect());
 }
@@ -123,9 +500,9 @@ bool BongardElement::isNorthOf(const BongardElement *other) const {
   return getOuterBoundRect().isNorthOf(other->getOuterBoundRect());
 }
 
-bool BongardElement::overflow() const {
+bool BongardElement::overflow(int bound) const {
   const Point &tp = getOuterBoundRect().getRightTop();
-  return tp.x_ >= BOUND || tp.y_ >= BOUND;
+  return tp.x_ >= bound || tp.y_ >= bound;
 }
 
 bool Rectangle::isInside(const Rectangle &other, int margin) const {
@@ -185,7 +562,7 @@ BongardTriangle::BongardTriangle(int x, int y, int width, bool up)
   int height = std::ceil(width * std::sqrt(3) / 2.0);
   setOuterBoundRect(x, y, width, height);
 
-  int inner_width = height * width / (height + width);
+  int inner_width = static_cast<long long>(height) * width / (height + width);
   if (up) {
     setInnerBoundRect(x + (width - inner_width) / 2, y, inner_width,
                       inner_width);
@@ -218,7 +595,8 @@ const Point &Rectangle::getRightTop() const { return rightTop_; }
 
 BongardElement::~BongardElement() {}
 
-BongardElement::BongardElement(id_type id) : id_(id) {}
+BongardElement::BongardElement(id_type id)
+    : id_(id), parent_(NULL), depth_(0) {}
 
 void BongardElement::setId(id_type id) { id_ = id; }
 
@@ -229,45 +607,268 @@ void BongardPicture::assignIDs(id_type &pid, id_type &eid) {
   }
 }
 
-void BongardPicture::output(FILE *elem, FILE *circle, FILE *rec, FILE *tri,
-                            FILE *tri_up, FILE *tri_down, FILE *inside,
-                            FILE *north, FILE *east) {
+void BongardPicture::output(relation rel, RelationFile *file) const {
+  writeRelation(rel, file);
+}
+
+void BongardPicture::output(relation rel, PrologFile *file) const {
+  writeRelation(rel, file);
+}
+
+template <typename Writer>
+void BongardPicture::writeRelation(relation rel, Writer *file) const {
+  const std::vector<std::pair<BongardElement *, BongardElement *>> *pairs;
+  switch (rel) {
+    case kRelationInside:
+      pairs = &inside_;
+      break;
+    case kRelationNorth:
+      pairs = &north_;
+      break;
+    case kRelationEast:
+      pairs = &east_;
+      break;
+    default:
+      pairs = NULL;
+  }
+  if (pairs != NULL) {
+    for (const std::pair<BongardElement *, BongardElement *> &pair : *pairs) {
+      file->write(pair.first->id_, pair.second->id_);
+    }
+    return;
+  }
+
+  for (const std::unique_ptr<BongardElement> &e : elems_) {
+    switch (rel) {
+      case kRelationElement:
+        file->write(id_, e->id_);
+        break;
+      case kRelationBox: {
+        const Rectangle &rect = e->getOuterBoundRect();
+        const int coords[4] = {rect.getLeftBottom().x_,
+                               rect.getLeftBottom().y_, rect.getRightTop().x_,
+                               rect.getRightTop().y_};
+        file->write(e->id_, coords, 4);
+        break;
+      }
+      case kRelationDirectlyInside:
+        if (e->parent_ != NULL) file->write(e->id_, e->parent_->id_);
+        break;
+      case kRelationDepth:
+        file->write(e->id_, &e->depth_, 1);
+        break;
+      default:
+        if (e->inRelation(rel)) file->write(e->id_);
+    }
+  }
+}
+
+namespace {
+
+bool lessByIds(const std::pair<BongardElement *, BongardElement *> &a,
+               const std::pair<BongardElement *, BongardElement *> &b) {
+  if (a.first->getId() != b.first->getId()) {
+    return a.first->getId() < b.first->getId();
+  }
+  return a.second->getId() < b.second->getId();
+}
+
+}  // namespace
+
+void BongardPicture::sortRelations() {
+  std::sort(inside_.begin(), inside_.end(), lessByIds);
+  std::sort(north_.begin(), north_.end(), lessByIds);
+  std::sort(east_.begin(), east_.end(), lessByIds);
+}
+
+namespace {
+
+template <typename T>
+void appendValue(std::vector<char> *record, T value) {
+  const char *bytes = reinterpret_cast<const char *>(&value);
+  record->insert(record->end(), bytes, bytes + sizeof(T));
+}
+
+void appendCSR(
+    std::vector<char> *record, id_type first_eid, uint32_t size,
+    const std::vector<std::pair<BongardElement *, BongardElement *>> &pairs) {
+  std::vector<uint32_t> offsets(size + 1, 0);
+  for (const std::pair<BongardElement *, BongardElement *> &pair : pairs) {
+    offsets[pair.first->getId() - first_eid + 1]++;
+  }
+  for (uint32_t i = 0; i < size; i++) offsets[i + 1] += offsets[i];
+
+  std::vector<uint32_t> targets(pairs.size());
+  std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+  for (const std::pair<BongardElement *, BongardElement *> &pair : pairs) {
+    targets[next[pair.first->getId() - first_eid]++] =
+        pair.second->getId() - first_eid;
+  }
+
+  for (uint32_t offset : offsets) appendValue(record, offset);
+  for (uint32_t target : targets) appendValue(record, target);
+}
+
+}  // namespace
+
+void BongardPicture::outputCSR(std::vector<char> *record) const {
+  const uint32_t size = elems_.size();
+  const id_type first_eid = size == 0 ? 0 : elems_.front()->getId();
+
+  record->clear();
+  appendValue<uint64_t>(record, id_);
+  appendValue<uint64_t>(record, first_eid);
+  appendValue<uint32_t>(record, size);
+  for (const std::unique_ptr<BongardElement> &e : elems_) {
+    appendValue<uint8_t>(record, e->shape());
+  }
+  record->resize((record->size() + 3) / 4 * 4, 0);
+
+  appendCSR(record, first_eid, size, inside_);
+  if (encoding_ == kEncodingCoordinates) {
+    for (const std::unique_ptr<BongardElement> &e : elems_) {
+      const Rectangle &rect = e->getOuterBoundRect();
+      appendValue<int32_t>(record, rect.getLeftBottom().x_);
+      appendValue<int32_t>(record, rect.getLeftBottom().y_);
+      appendValue<int32_t>(record, rect.getRightTop().x_);
+      appendValue<int32_t>(record, rect.getRightTop().y_);
+    }
+  } else {
+    appendCSR(record, first_eid, size, north_);
+    appendCSR(record, first_eid, size, east_);
+  }
+  record->resize((record->size() + 7) / 8 * 8, 0);
+}
+
+size_t BongardPicture::memoryBytes() const {
+  size_t bytes = sizeof(*this) + elems_.capacity() * sizeof(elems_[0]) +
+                 (inside_.capacity() + north_.capacity() + east_.capacity()) *
+                     sizeof(inside_[0]);
   for (const std::unique_ptr<BongardElement> &e : elems_) {
-    fprintf(elem, "%llu|%llu\n", id_, e->id_);
-    e->output(circle, rec, tri, tri_up, tri_down);
+    bytes += e->memoryBytes() +
+             e->children_.capacity() * sizeof(e->children_[0]);
   }
+  if (grid_) bytes += grid_->memoryBytes();
+  return bytes;
+}
 
-  for (const std::pair<BongardElement *, BongardElement *> &pair : inside_) {
-    fprintf(inside, "%llu|%llu\n", pair.first->id_, pair.second->id_);
+id_type countCoordinatePairs(const std::vector<int> &low,
+                             std::vector<int> high) {
+  std::sort(high.begin(), high.end());
+  id_type count = 0;
+  for (int lo : low) {
+    count += std::lower_bound(high.begin(), high.end(), lo) - high.begin();
   }
+  return count;
+}
 
-  for (std::pair<BongardElement *, BongardElement *> &pair : north_) {
-    fprintf(north, "%llu|%llu\n", pair.first->id_, pair.second->id_);
+void BongardPicture::collectStats(DatasetStats *stats) const {
+  id_type max_depth = 0;
+  for (const std::unique_ptr<BongardElement> &e : elems_) {
+    stats->addShape(e->shape());
+    // A depth is never negative.
+    const id_type depth = static_cast<id_type>(e->depth_);
+    if (depth > max_depth) max_depth = depth;
   }
 
-  for (std::pair<BongardElement *, BongardElement *> &pair : east_) {
-    fprintf(east, "%llu|%llu\n", pair.first->id_, pair.second->id_);
+  id_type num_norths = north_.size();
+  id_type num_easts = east_.size();
+  if (encoding_ == kEncodingCoordinates) {
+    std::vector<int> left, bottom, right, top;
+    for (const std::unique_ptr<BongardElement> &e : elems_) {
+      const Rectangle &rect = e->getOuterBoundRect();
+      left.push_back(rect.getLeftBottom().x_);
+      bottom.push_back(rect.getLeftBottom().y_);
+      right.push_back(rect.getRightTop().x_);
+      top.push_back(rect.getRightTop().y_);
+    }
+    num_easts = countCoordinatePairs(left, right);
+    num_norths = countCoordinatePairs(bottom, top);
   }
+  stats->addPicture(elems_.size(), inside_.size(), num_norths, num_easts,
+                    max_depth);
+}
+
+bool BongardCircle::inRelation(relation rel) const {
+  return rel == kRelationCircle;
 }
 
-void BongardCircle::output(FILE *circle, FILE *rec, FILE *tri, FILE *tri_up,
-                           FILE *tri_down) const {
-  fprintf(circle, "%llu\n", getId());
+bool BongardSquare::inRelation(relation rel) const {
+  return rel == kRelationRectangle;
 }
 
-void BongardSquare::output(FILE *circle, FILE *rec, FILE *tri, FILE *tri_up,
-                           FILE *tri_down) const {
-  fprintf(rec, "%llu\n", getId());
+bool BongardTriangle::inRelation(relation rel) const {
+  return rel == kRelationTriangle ||
+         rel == (point_orientation_ ? kRelationTriangleUp
+                                    : kRelationTriangleDown);
 }
 
-void BongardTriangle::output(FILE *circle, FILE *rec, FILE *tri, FILE *tri_up,
-                             FILE *tri_down) const {
-  fprintf(tri, "%llu\n", getId());
+size_t BongardCircle::memoryBytes() const { return sizeof(*this); }
+
+size_t BongardSquare::memoryBytes() const { return sizeof(*this); }
+
+size_t BongardTriangle::memoryBytes() const { return sizeof(*this); }
+
+shape_geometry BongardCircle::geometry() const {
+  shape_geometry g;
+  g.disc_ = true;
+  g.cx_ = leftBottom_.x_ + radius_;
+  g.cy_ = leftBottom_.y_ + radius_;
+  g.r_ = radius_;
+  g.n_ = 0;
+  return g;
+}
+
+shape_geometry BongardSquare::geometry() const {
+  const double x = leftBottom_.x_;
+  const double y = leftBottom_.y_;
+  shape_geometry g;
+  g.disc_ = false;
+  g.n_ = 4;
+  g.x_[0] = x;
+  g.y_[0] = y;
+  g.x_[1] = x + w_;
+  g.y_[1] = y;
+  g.x_[2] = x + w_;
+  g.y_[2] = y + w_;
+  g.x_[3] = x;
+  g.y_[3] = y + w_;
+  g.setEdges();
+  return g;
+}
+
+shape_geometry BongardTriangle::geometry() const {
+  const double x = leftBottom_.x_;
+  const double y = leftBottom_.y_;
+  const int height = std::ceil(w_ * std::sqrt(3) / 2.0);
+  shape_geometry g;
+  g.disc_ = false;
+  g.n_ = 3;
   if (point_orientation_) {
-    fprintf(tri_up, "%llu\n", getId());
+    g.x_[0] = x;
+    g.y_[0] = y;
+    g.x_[1] = x + w_;
+    g.y_[1] = y;
+    g.x_[2] = x + w_ / 2.0;
+    g.y_[2] = y + height;
   } else {
-    fprintf(tri_down, "%llu\n", getId());
+    g.x_[0] = x + w_ / 2.0;
+    g.y_[0] = y;
+    g.x_[1] = x + w_;
+    g.y_[1] = y + height;
+    g.x_[2] = x;
+    g.y_[2] = y + height;
   }
+  g.setEdges();
+  return g;
+}
+
+ShapeType BongardCircle::shape() const { return kCircle; }
+
+ShapeType BongardSquare::shape() const { return kSquare; }
+
+ShapeType BongardTriangle::shape() const {
+  return point_orientation_ ? kTriangleUp : kTriangleDown;
 }
 
 std::string BongardCircle::string() const {
@@ -288,4 +889,78 @@ std::string BongardTriangle::string() const {
   return str.str();
 }
 
+namespace {
+
+/** The shape and the bounding box (left, bottom, right, top) of an element. */
+typedef std::array<long long, 5> element_tuple;
+
+}  // namespace
+
+std::uint64_t BongardPicture::canonicalHash(int invariance) const {
+  std::vector<element_tuple> tuples;
+  tuples.reserve(elems_.size());
+  for (const std::unique_ptr<BongardElement> &e : elems_) {
+    const shape_geometry g = e->geometry();
+    element_tuple t;
+    t[0] = e->shape();
+    if (g.disc_) {
+      t[1] = std::llround(g.cx_ - g.r_);
+      t[2] = std::llround(g.cy_ - g.r_);
+      t[3] = std::llround(g.cx_ + g.r_);
+      t[4] = std::llround(g.cy_ + g.r_);
+    } else {
+      t[1] = std::llround(*std::min_element(g.x_, g.x_ + g.n_));
+      t[2] = std::llround(*std::min_element(g.y_, g.y_ + g.n_));
+      t[3] = std::llround(*std::max_element(g.x_, g.x_ + g.n_));
+      t[4] = std::llround(*std::max_element(g.y_, g.y_ + g.n_));
+    }
+    tuples.push_back(t);
+  }
+
+  // Bit 0 of a mirror flips left and right, bit 1 flips top and bottom.
+  const int num_mirrors = invariance & kInvariantReflection ? 4 : 1;
+  std::vector<element_tuple> best;
+  std::vector<element_tuple> mirrored;
+  for (int mirror = 0; mirror < num_mirrors; mirror++) {
+    mirrored = tuples;
+    long long min_x = bound_;
+    long long min_y = bound_;
+    for (element_tuple &t : mirrored) {
+      if (mirror & 1) {
+        const long long lx = t[1];
+        t[1] = bound_ - t[3];
+        t[3] = bound_ - lx;
+      }
+      if (mirror & 2) {
+        const long long ly = t[2];
+        t[2] = bound_ - t[4];
+        t[4] = bound_ - ly;
+        if (t[0] == kTriangleUp) {
+          t[0] = kTriangleDown;
+        } else if (t[0] == kTriangleDown) {
+          t[0] = kTriangleUp;
+        }
+      }
+      min_x = std::min(min_x, t[1]);
+      min_y = std::min(min_y, t[2]);
+    }
+    if (invariance & kInvariantTranslation) {
+      for (element_tuple &t : mirrored) {
+        t[1] -= min_x;
+        t[2] -= min_y;
+        t[3] -= min_x;
+        t[4] -= min_y;
+      }
+    }
+    std::sort(mirrored.begin(), mirrored.end());
+    if (mirror == 0 || mirrored < best) best.swap(mirrored);
+  }
+
+  std::uint64_t h = mixHash(best.size());
+  for (const element_tuple &t : best) {
+    for (long long v : t) h = mixHash(h ^ static_cast<std::uint64_t>(v));
+  }
+  return h;
+}
+
 }  // namespace bongard
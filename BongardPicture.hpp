@@ -20,6 +20,7 @@
 #define BONGARD_PICTURE_HPP_
 
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <fstream>
 #include <memory>
@@ -29,14 +30,129 @@
 #include <vector>
 
 #include "Configurations.hpp"
+#include "Geometry.hpp"
+#include "PlacementKernel.hpp"
+#include "PrologFile.hpp"
+#include "RandomEngine.hpp"
+#include "RelationFile.hpp"
+#include "SpatialGrid.hpp"
 
 namespace bongard {
 
+class DatasetStats;
+
+/**
+ * @brief The shape of an element.
+ */
+enum ShapeType {
+  kSquare = 0,
+  kCircle,
+  kTriangleUp,
+  kTriangleDown,
+  kNumShapeTypes
+};
+
+/**
+ * @return The name of the relation that stores the elements of \p shape.
+ */
+const char *shapeName(ShapeType shape);
+
+/**
+ * @brief The encodings of the north and east relations.
+ */
+enum relation_encoding {
+  /** Every pair of elements in the relation is materialized. */
+  kEncodingPairs = 0,
+  /**
+   * Only the bounding box of every element is kept. An element is on the
+   * north (east) of another iff the bottom (left) of its bounding box is
+   * above (right of) the top (right) of the other's.
+   */
+  kEncodingCoordinates
+};
+
+/**
+ * @brief The relations of the text layout, each written to its own file.
+ */
+enum relation {
+  kRelationElement = 0,
+  kRelationRectangle,
+  kRelationCircle,
+  kRelationTriangle,
+  kRelationTriangleUp,
+  kRelationTriangleDown,
+  kRelationInside,
+  kRelationNorth,
+  kRelationEast,
+  kRelationBox,
+  kRelationDirectlyInside,
+  kRelationDepth
+};
+
+/**
+ * @return The name of the relation \p rel, which is the name of its file and
+ *         of its Prolog predicate.
+ */
+const char *relationName(relation rel);
+
+/**
+ * @brief The transformations under which equivalent pictures have the same
+ *        canonical hash, combined as a bit mask.
+ */
+enum hash_invariance {
+  kInvariantNone = 0,
+  /** The pictures are compared relative to the bounding box of the elements. */
+  kInvariantTranslation = 1,
+  /** The mirror images of a picture (horizontally, vertically or both). */
+  kInvariantReflection = 2
+};
+
+/**
+ * @brief Count the pairs (a, b) with \p low[a] > \p high[b] in O(n log n).
+ * @details With the bounding box coordinates of the elements of a picture,
+ *          this is the size of a relation in the coordinate encoding.
+ */
+id_type countCoordinatePairs(const std::vector<int> &low,
+                             std::vector<int> high);
+
+/**
+ * @brief Counters of the work spent in generating pictures.
+ */
+struct placement_stats {
+  placement_stats()
+      : pictures_(0),
+        picture_trials_(0),
+        element_trials_(0),
+        element_failures_(0),
+        rollbacks_(0),
+        inside_shortfalls_(0),
+        duplicates_(0) {}
+
+  void merge(const placement_stats &other);
+
+  std::string string() const;
+
+  /** The number of accepted pictures. */
+  id_type pictures_;
+  /** The number of pictures started from scratch. */
+  id_type picture_trials_;
+  /** The number of drawn elements. */
+  id_type element_trials_;
+  /** The number of times the trial budget of an element was exhausted. */
+  id_type element_failures_;
+  /** The number of times a picture was rolled back by one element. */
+  id_type rollbacks_;
+  /** The number of complete pictures with too few inside pairs. */
+  id_type inside_shortfalls_;
+  /** The number of pictures rejected as duplicates. */
+  id_type duplicates_;
+};
+
 /**
  * @brief Picture parameters
  */
 struct picture_params {
-  picture_params(int min_insides, std::mt19937 &gen,
+  picture_params(int min_insides, RandomEngine &gen,
                  std::uniform_int_distribution<> &coord_dist,
                  std::uniform_int_distribution<> &type_dist,
                  std::uniform_int_distribution<> &size_dist)
@@ -44,17 +160,54 @@ struct picture_params {
         gen_(gen),
         coord_dist_(coord_dist),
         type_dist_(type_dist),
-        size_dist_(size_dist) {}
+        size_dist_(size_dist),
+        bound_(BOUND),
+        sweep_(false),
+        spatial_index_(false),
+        exact_geometry_(false),
+        encoding_(kEncodingPairs),
+        kernel_(NULL) {}
 
   /**
    * The minimum number of pairs of elements in which one should be inside of
    * the other.
    */
   const int min_insides_;
-  std::mt19937 &gen_;
+  RandomEngine &gen_;
   std::uniform_int_distribution<> &coord_dist_;
   std::uniform_int_distribution<> &type_dist_;
   std::uniform_int_distribution<> &size_dist_;
+
+  /** The length and the width of the picture. */
+  int bound_;
+
+  /**
+   * Compute the relations by sorting and sweeping the bounding boxes instead
+   * of testing all pairs of elements.
+   */
+  bool sweep_;
+
+  /**
+   * Find the elements conflicting with a new element with a SpatialGrid
+   * instead of testing all elements.
+   */
+  bool spatial_index_;
+
+  /**
+   * Test the conflict and the inside relation of elements by their exact
+   * shapes instead of their bounding rectangles.
+   */
+  bool exact_geometry_;
+
+  relation_encoding encoding_;
+
+  /**
+   * The kernel specialized for the picture bound and the maximum number of
+   * elements, or NULL for the generic placement.
+   */
+  placement_kernel kernel_;
+
+  placement_stats stats_;
 };
 
 struct Point {
@@ -91,6 +244,15 @@ class Rectangle {
    */
   const Point &getRightTop() const;
 
+  /**
+   *
+   * @return The area of the rectangle.
+   */
+  inline long long area() const {
+    return static_cast<long long>(rightTop_.x_ - leftBottom_.x_) *
+           (rightTop_.y_ - leftBottom_.y_);
+  }
+
   /**
    * @brief Test whether this rectangle is inside of the \p other with an
    *        separate space of at least \p margin.
@@ -197,6 +359,28 @@ class BongardElement {
    */
   bool isInside(const BongardElement *other) const;
 
+  /**
+   * @brief Test if the exact shapes of this element and the \p other are
+   *        partially overlapped.
+   * @details The bounding rectangles decide the pairs that are apart or
+   *          clearly nested; only the others are tested by their shapes.
+   *
+   * @param other The second element to be checked with.
+   * @return True if neither shape is inside of the other and they are not
+   *         separated by more than MARGIN.
+   */
+  bool conflictExact(const BongardElement *other) const;
+
+  /**
+   * @brief Test if the exact shape of this element is inside of the shape of
+   *        the \p other.
+   *
+   * @param other The second element to be checked with.
+   * @return True if this element is inside of the \p other with a separate
+   *         space of at least MARGIN.
+   */
+  bool isInsideExact(const BongardElement *other) const;
+
   /**
    * @brief Test if it is on the east of the \p other
    *
@@ -215,18 +399,48 @@ class BongardElement {
 
   /**
    * @brief Test boundary overflow.
+   * @param bound The length and the width of the picture.
    * @return True if this element exceed the picture boundary.
    */
-  bool overflow() const;
+  bool overflow(int bound = BOUND) const;
 
-  virtual void output(FILE *circle,
-                      FILE *rec,
-                      FILE *tri,
-                      FILE *tri_up,
-                      FILE *tri_down) const = 0;
+  /**
+   * @return True if this element is in the shape relation \p rel.
+   */
+  virtual bool inRelation(relation rel) const = 0;
 
   virtual std::string string() const = 0;
 
+  virtual ShapeType shape() const = 0;
+
+  virtual shape_geometry geometry() const = 0;
+
+  /**
+   * @return The size of this element object.
+   */
+  virtual size_t memoryBytes() const = 0;
+
+  /**
+   *
+   * @return The element that immediately encloses this element in the
+   *         containment forest, or NULL for a root.
+   */
+  inline const BongardElement *getParent() const { return parent_; }
+
+  /**
+   *
+   * @return The elements immediately enclosed by this element.
+   */
+  inline const std::vector<BongardElement *> &getChildren() const {
+    return children_;
+  }
+
+  /**
+   *
+   * @return The number of elements that enclose this element.
+   */
+  inline int getDepth() const { return depth_; }
+
  protected:
   void setOuterBoundRect(int x, int y, int w, int h);
   void setInnerBoundRect(int x, int y, int w, int h);
@@ -237,6 +451,10 @@ class BongardElement {
   id_type id_;
   Rectangle outer_rect_;
   Rectangle inner_rect_;
+
+  BongardElement *parent_;
+  std::vector<BongardElement *> children_;
+  int depth_;
 };
 
 /**
@@ -253,14 +471,16 @@ class BongardCircle : public BongardElement {
    */
   BongardCircle(int x, int y, int d);
 
-  void output(FILE *circle,
-              FILE *rec,
-              FILE *tri,
-              FILE *tri_up,
-              FILE *tri_down) const;
+  bool inRelation(relation rel) const;
 
   std::string string() const;
 
+  ShapeType shape() const;
+
+  shape_geometry geometry() const;
+
+  size_t memoryBytes() const;
+
  private:
   Point leftBottom_;
   int radius_;
@@ -280,14 +500,16 @@ class BongardSquare : public BongardElement {
    */
   BongardSquare(int x, int y, int w);
 
-  void output(FILE *circle,
-              FILE *rec,
-              FILE *tri,
-              FILE *tri_up,
-              FILE *tri_down) const;
+  bool inRelation(relation rel) const;
 
   std::string string() const;
 
+  ShapeType shape() const;
+
+  shape_geometry geometry() const;
+
+  size_t memoryBytes() const;
+
  private:
   Point leftBottom_;
   int w_;
@@ -305,14 +527,16 @@ class BongardTriangle : public BongardElement {
    */
   BongardTriangle(int x, int y, int w, bool orient);
 
-  void output(FILE *circle,
-              FILE *rec,
-              FILE *tri,
-              FILE *tri_up,
-              FILE *tri_down) const;
+  bool inRelation(relation rel) const;
 
   std::string string() const;
 
+  ShapeType shape() const;
+
+  shape_geometry geometry() const;
+
+  size_t memoryBytes() const;
+
  private:
   Point leftBottom_;
   int w_;
@@ -327,9 +551,10 @@ class BongardPicture {
   /**
    * @brief Constructor.
    *
-   * @param p Picture parameters.
+   * @param p Picture parameters. They are only used until the picture is
+   *          created, so a picture can outlive them.
    */
-  BongardPicture(picture_params p);
+  BongardPicture(picture_params &p);
 
   /**
    * @brief Assign IDs to itself and to its elements.
@@ -342,6 +567,13 @@ class BongardPicture {
 
   /**
    * @brief Create a picture with \p size elements.
+   * @details The elements are drawn with a trial budget of MIN_TRY each.
+   *          When an element cannot be placed, or the complete picture has
+   *          too few inside pairs, the last element is removed and drawn
+   *          again, doubling the budget in the former case. The picture is
+   *          given up after MAX_ROLLBACKS rollbacks, or when an element
+   *          cannot be placed in MAX_TRY trials.
+   *
    * @param size The number of elements in the picture.
    * @return True if a picture is successfully generated; otherwise, false.
    */
@@ -352,6 +584,17 @@ class BongardPicture {
    */
   BongardElement *createElement();
 
+  /**
+   * @brief Create the element of shape \p fig.
+   *
+   * @param fig 1 for square, 2 for circle, 3 for point-down triangle and 4
+   *            for point-up triangle.
+   * @param x Left bottom x-coordinate.
+   * @param y Left bottom y-coordinate.
+   * @param size The size of the element.
+   */
+  static BongardElement *createElement(int fig, int x, int y, int size);
+
   /**
    * @brief Test if the element violates any restriction
    * @details An element should be partiall overlapped with another element in
@@ -362,21 +605,116 @@ class BongardPicture {
    */
   bool isValid(BongardElement *elem) const;
 
+  /**
+   * @brief Account for this picture in the dataset statistics \p stats.
+   */
+  void collectStats(DatasetStats *stats) const;
+
+  /**
+   * @brief Hash the picture by the shapes and the bounding boxes of its
+   *        elements, sorted, so that the order of the elements does not
+   *        matter.
+   * @details With kInvariantReflection, the smallest sorted sequence of the
+   *          mirror images is hashed.
+   *
+   * @param invariance A bit mask of hash_invariance.
+   */
+  std::uint64_t canonicalHash(int invariance) const;
+
+  /**
+   * @return The bytes held by this picture: the picture, its elements, the
+   *         capacity of its vectors and of those of its elements, and its
+   *         spatial index, without the overhead of the allocator.
+   */
+  size_t memoryBytes() const;
+
  private:
+  /**
+   * @brief Draw elements until the picture has \p size elements.
+   * @return False if an element cannot be placed in \p budget trials.
+   */
+  bool placeElements(unsigned size, long long budget);
+
+  /**
+   * @brief Remove the last element.
+   */
+  void rollback();
+
   void populate();
+  void populateSweep();
+
+  /**
+   * @brief Build the containment forest of the elements.
+   * @details The bounding boxes of the elements in a valid picture are either
+   *          nested or separated. The boxes are swept by their left side;
+   *          the boxes that cross the sweep line are pairwise nested or
+   *          separated vertically, so they are kept ordered by their bottom
+   *          side and the parent of a new box is found by a binary search
+   *          followed by a walk up the forest. It takes O(n log n) plus the
+   *          length of the walks, which is bounded by the nesting depth.
+   */
+  void buildForest();
+
+  /**
+   * @brief Build the containment forest by the exact shapes.
+   * @details Nested shapes need not have nested bounding boxes, so every pair
+   *          of elements is tested. The elements enclosing an element form a
+   *          chain, of which the deepest one is the parent.
+   */
+  void buildForestExact();
+
+  /**
+   * @brief Test if \p a is inside of \p b; with exact geometry, this is read
+   *        from the forest, which is built by the exact tests.
+   */
+  bool isInside(const BongardElement *a, const BongardElement *b) const;
 
-  void output(FILE *elem,
-              FILE *circle,
-              FILE *rec,
-              FILE *tri,
-              FILE *tri_up,
-              FILE *tri_down,
-              FILE *inside,
-              FILE *north,
-              FILE *east);
+  /**
+   * @brief Write the rows of the relation \p rel of this picture to \p file.
+   * @details The picture is only read, so the relations of a picture can be
+   *          written by different threads at the same time.
+   */
+  void output(relation rel, RelationFile *file) const;
+  void output(relation rel, PrologFile *file) const;
+
+  /**
+   * @brief Write the rows of the relation \p rel to \p writer, which is a
+   *        RelationFile or a PrologFile.
+   */
+  template <typename Writer>
+  void writeRelation(relation rel, Writer *writer) const;
+
+  /**
+   * @brief Sort the pairs of every relation by the first and then the second
+   *        element ID, which orders a fold by these columns as the element
+   *        IDs of consecutive pictures are increasing.
+   */
+  void sortRelations();
+
+  /**
+   * @brief Encode the picture as one contiguous binary record.
+   * @details All integers are in the native byte order. The record is
+   *          - uint64 picture id, uint64 id of the first element and uint32
+   *            number of elements n; the element ids are consecutive;
+   *          - n uint8 shape codes (ShapeType), padded to a multiple of 4;
+   *          - for each of inside, north and east, the compressed sparse
+   *            rows of the relation: n + 1 uint32 row offsets followed by
+   *            the uint32 local indexes (element id - first id) of the
+   *            second elements, grouped by the first element;
+   *          - with kEncodingCoordinates, the rows of north and east are
+   *            replaced by the int32 bounding box (left, bottom, right,
+   *            top) of every element;
+   *          - padding to a multiple of 8 bytes.
+   *
+   * @param record Replaced by the encoded record.
+   */
+  void outputCSR(std::vector<char> *record) const;
 
   picture_params &p_;
+  relation_encoding encoding_;
+  int bound_;
   std::vector<std::unique_ptr<BongardElement>> elems_;
+  std::unique_ptr<SpatialGrid> grid_;
   std::vector<std::pair<BongardElement *, BongardElement *>> inside_;
   std::vector<std::pair<BongardElement *, BongardElement *>> north_;
   std::vector<std::pair<BongardElement *, BongardElement *>> east_;
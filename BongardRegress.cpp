@@ -0,0 +1,594 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <sys/resource.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BongardGenerator.hpp"
+#include "Configurations.hpp"
+#include "DuplicateFilter.hpp"
+#include "ParameterSweep.hpp"
+#include "RandomEngine.hpp"
+
+namespace {
+
+using bongard::generator_options;
+using bongard::generator_params;
+
+/** The seed of the reference datasets. */
+const std::uint64_t kSeed = 20141018;
+
+/**
+ * The standard normal quantile of the significance level of the
+ * distribution checks (p = 1e-4), for few false alarms over all checks.
+ */
+const double kQuantile = 3.719;
+
+/** The smallest count of a histogram bucket that is tested on its own. */
+const id_type kMinBucket = 10;
+
+/**
+ * @brief A fixed-seed dataset.
+ */
+struct regress_case {
+  const char *name_;
+  generator_params p_;
+  id_type num_;
+  void (*setup_)(generator_options *opts);
+  /**
+   * If true, the dataset is a sweep of two configurations "a" and "b" of
+   * p_ and num_, each with its own duplicate filter if opts.dedup_ is set.
+   */
+  bool sweep_;
+};
+
+/**
+ * @brief A way of generating the datasets of the cases.
+ */
+struct regress_variant {
+  const char *name_;
+  /**
+   * If true, the files must be equal to those of the reference; otherwise
+   * only the distributions of the stats are compared.
+   */
+  bool exact_;
+  void (*setup_)(generator_options *opts);
+};
+
+const regress_case kCases[] = {
+    {"default", generator_params(4, 6, 2, 98, 1), 2000,
+     [](generator_options *opts) {
+       opts->layout_ = bongard::kLayoutText | bongard::kLayoutCSR;
+     },
+     false},
+    {"forest_sorted", generator_params(4, 6, 2, 98, 1), 2000,
+     [](generator_options *opts) {
+       opts->forest_ = true;
+       opts->sorted_ = true;
+     },
+     false},
+    {"coordinates", generator_params(4, 8, 2, 60, 0), 2000,
+     [](generator_options *opts) {
+       opts->layout_ = bongard::kLayoutText | bongard::kLayoutCSR;
+       opts->encoding_ = bongard::kEncodingCoordinates;
+       opts->forest_ = true;
+     },
+     false},
+    {"large", generator_params(20, 40, 2, 60, 0, 1000), 200,
+     [](generator_options *opts) { opts->large_pictures_ = true; },
+     false},
+    {"exact", generator_params(4, 6, 2, 98, 1, BOUND, true), 1000,
+     [](generator_options *) {}, false},
+    {"dedup", generator_params(2, 3, 10, 14, 0), 3000,
+     [](generator_options *opts) {
+       opts->dedup_.reset(new bongard::ConcurrentHashSet);
+       opts->dedup_invariance_ =
+           bongard::kInvariantTranslation | bongard::kInvariantReflection;
+     },
+     false},
+    {"prolog", generator_params(4, 6, 2, 98, 1), 1000,
+     [](generator_options *opts) {
+       opts->layout_ = bongard::kLayoutProlog;
+       opts->prolog_shards_ = 3;
+     },
+     false},
+    {"budget", generator_params(4, 6, 2, 98, 1), 2000,
+     [](generator_options *opts) { opts->memory_budget_ = 256 << 10; },
+     false},
+    {"sweep_dedup", generator_params(1, 2, 2, 6, 0, 20), 3000,
+     [](generator_options *opts) {
+       opts->dedup_.reset(new bongard::ConcurrentHashSet);
+     },
+     true},
+};
+
+const regress_variant kVariants[] = {
+    {"reference", true,
+     [](generator_options *opts) {
+       opts->num_threads_ = 1;
+       opts->kernels_ = false;
+     }},
+    {"threads", true, [](generator_options *opts) { opts->num_threads_ = 8; }},
+    {"direct_io", true,
+     [](generator_options *opts) {
+       opts->num_threads_ = 3;
+       opts->io_ = bongard::kIODirect;
+     }},
+    {"mt19937_64", false,
+     [](generator_options *opts) {
+       opts->engine_ = bongard::kEngineMT19937_64;
+     }},
+    {"splitmix64", false,
+     [](generator_options *opts) {
+       opts->engine_ = bongard::kEngineSplitMix64;
+     }},
+    {"other_seed", false,
+     [](generator_options *opts) { opts->seed_ = kSeed + 1; }},
+};
+
+/**
+ * Parameters that must be rejected before generating, since the pictures of
+ * some number of elements in their range can never be generated.
+ */
+const generator_params kInfeasibleParams[] = {
+    // Two elements make one inside pair at most.
+    generator_params(2, 6, 2, 98, 5),
+    // Sixteen elements of size 20 or more do not fit in a picture of bound
+    // 50, while one does.
+    generator_params(1, 30, 20, 30, 0, 50),
+};
+
+/**
+ * The memory budget of the memory check, which generates many more bytes of
+ * pictures than the budget with many threads.
+ */
+const id_type kMemoryBudget = 16 << 20;
+
+const regress_case kMemoryCase = {
+    "memory", generator_params(4, 6, 2, 98, 0), 200000,
+    [](generator_options *opts) { opts->memory_budget_ = kMemoryBudget; },
+    false};
+
+const regress_variant kMemoryVariant = {
+    "threads", true, [](generator_options *opts) { opts->num_threads_ = 16; }};
+
+/** The byte digests of the files of a dataset, by their relative path. */
+typedef std::map<std::string, std::string> digest_map;
+
+/** The histograms of the stats files of a dataset, by their name. */
+typedef std::map<std::string, std::map<std::string, id_type>> stats_map;
+
+/**
+ * @brief The golden output: the digests and the stats of every case.
+ */
+struct golden_output {
+  /** The toolchain of the build that recorded the output, see toolchain. */
+  std::string toolchain_;
+  std::map<std::string, digest_map> digests_;
+  std::map<std::string, stats_map> stats_;
+};
+
+/**
+ * @return The compiler and the standard library of this build. The
+ *         distributions of the standard library are implementation-defined,
+ *         so the digests only hold for the toolchain that recorded them.
+ */
+std::string toolchain() {
+  std::ostringstream str;
+#if defined(__clang__)
+  str << "Clang " << __clang_major__ << "." << __clang_minor__ << "."
+      << __clang_patchlevel__;
+#elif defined(__GNUC__)
+  str << "GCC " << __GNUC__ << "." << __GNUC_MINOR__ << "."
+      << __GNUC_PATCHLEVEL__;
+#else
+  str << "unknown compiler";
+#endif
+#if defined(_LIBCPP_VERSION)
+  str << ", libc++ " << _LIBCPP_VERSION;
+#elif defined(__GLIBCXX__)
+  str << ", libstdc++ " << __GLIBCXX__;
+#endif
+  return str.str();
+}
+
+/**
+ * @return The peak resident set size of the process in KB.
+ */
+long peakRSSKilobytes() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+/**
+ * @return "BYTES|DIGEST" of the file \p path, where the digest is the 64-bit
+ *         FNV-1a hash of its bytes.
+ */
+std::string fileDigest(const boost::filesystem::path &path) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == NULL) return "missing";
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  id_type bytes = 0;
+  std::vector<unsigned char> buffer(1 << 20);
+  size_t n;
+  while ((n = fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      hash = (hash ^ buffer[i]) * 0x100000001b3ULL;
+    }
+    bytes += n;
+  }
+  fclose(file);
+  char text[64];
+  snprintf(text, sizeof(text), "%llu|%016llx", bytes,
+           static_cast<unsigned long long>(hash));
+  return text;
+}
+
+/**
+ * @brief Add the histograms of the stats file \p path to \p stats.
+ */
+void readStats(const boost::filesystem::path &path, stats_map *stats) {
+  std::ifstream in(path.string());
+  std::string line;
+  while (std::getline(in, line)) {
+    std::vector<std::string> fields;
+    boost::split(fields, line, boost::is_any_of(" "),
+                 boost::token_compress_on);
+    if (fields.empty() || fields[0] == "#pictures:") continue;
+    std::map<std::string, id_type> &hist = (*stats)[fields[0]];
+    for (size_t i = 1; i < fields.size(); i++) {
+      const size_t colon = fields[i].rfind(':');
+      if (colon == std::string::npos) continue;
+      hist[fields[i].substr(0, colon)] +=
+          std::strtoull(fields[i].c_str() + colon + 1, NULL, 10);
+    }
+  }
+}
+
+/**
+ * @brief Generate the dataset of \p c with \p v into \p dir.
+ * @details The summaries are not digested, as they give the peak RSS.
+ */
+bool generate(const regress_case &c, const regress_variant &v,
+              const boost::filesystem::path &dir, digest_map *digests,
+              stats_map *stats) {
+  boost::filesystem::remove_all(dir);
+  boost::filesystem::create_directories(dir);
+
+  generator_options opts;
+  opts.seeded_ = true;
+  opts.seed_ = kSeed;
+  c.setup_(&opts);
+  v.setup_(&opts);
+
+  // The progress of the generator is not shown.
+  std::ostringstream progress;
+  std::streambuf *out = std::cout.rdbuf(progress.rdbuf());
+  bool ok;
+  if (c.sweep_) {
+    std::vector<bongard::sweep_config> configs;
+    for (const char *name : {"a", "b"}) {
+      configs.emplace_back(name, c.num_, c.p_);
+      if (opts.dedup_) {
+        configs.back().dedup_.reset(new bongard::ConcurrentHashSet);
+      }
+    }
+    ok = bongard::runSweep(configs, dir.string(), opts);
+  } else {
+    bongard::BongardGenerator gen(c.p_, dir.string(), 0, 0, 0, opts);
+    ok = gen.generate(c.num_);
+  }
+  std::cout.rdbuf(out);
+  if (!ok) return false;
+
+  for (boost::filesystem::recursive_directory_iterator it(dir), end;
+       it != end; ++it) {
+    if (!boost::filesystem::is_regular_file(it->path())) continue;
+    const std::string name = it->path().filename().string();
+    if (name == "summary") continue;
+    if (name == "stats") readStats(it->path(), stats);
+    const std::string path = it->path().string();
+    (*digests)[path.substr(dir.string().size() + 1)] = fileDigest(it->path());
+  }
+  return true;
+}
+
+/**
+ * @brief Test whether two histograms are drawn from the same distribution
+ *        by the chi-square test of homogeneity.
+ * @details The buckets below kMinBucket in both histograms are pooled.
+ *
+ * @param message Set to the statistic and the critical value.
+ * @return False if the hypothesis is rejected at the level of kQuantile.
+ */
+bool sameDistribution(const std::map<std::string, id_type> &a,
+                      const std::map<std::string, id_type> &b,
+                      std::string *message) {
+  std::map<std::string, std::pair<double, double>> buckets;
+  for (const std::pair<const std::string, id_type> &e : a) {
+    buckets[e.first].first = e.second;
+  }
+  for (const std::pair<const std::string, id_type> &e : b) {
+    buckets[e.first].second = e.second;
+  }
+
+  double total_a = 0, total_b = 0;
+  std::vector<std::pair<double, double>> tested;
+  std::pair<double, double> pooled(0, 0);
+  for (const std::pair<const std::string, std::pair<double, double>> &e :
+       buckets) {
+    total_a += e.second.first;
+    total_b += e.second.second;
+    if (e.second.first + e.second.second >= kMinBucket) {
+      tested.push_back(e.second);
+    } else {
+      pooled.first += e.second.first;
+      pooled.second += e.second.second;
+    }
+  }
+  if (pooled.first + pooled.second > 0) tested.push_back(pooled);
+  if (total_a == 0 || total_b == 0) return total_a == total_b;
+  if (tested.size() < 2) return true;
+
+  const double ka = std::sqrt(total_b / total_a);
+  const double kb = std::sqrt(total_a / total_b);
+  double chi2 = 0;
+  for (const std::pair<double, double> &t : tested) {
+    const double d = ka * t.first - kb * t.second;
+    chi2 += d * d / (t.first + t.second);
+  }
+  // The Wilson-Hilferty approximation of the chi-square quantile.
+  const double dof = tested.size() - 1;
+  const double w = 2.0 / (9.0 * dof);
+  const double critical = dof * std::pow(1 - w + kQuantile * std::sqrt(w), 3);
+
+  std::ostringstream str;
+  str << "chi2 " << chi2 << " (critical " << critical << ", " << dof
+      << " dof)";
+  *message = str.str();
+  return chi2 <= critical;
+}
+
+bool writeGolden(const std::string &path, const golden_output &golden) {
+  FILE *file = fopen(path.c_str(), "w");
+  if (file == NULL) {
+    std::cerr << "Error: cannot write " << path << ".\n";
+    return false;
+  }
+  fprintf(file, "# bongard_regress golden output, seed %llu\n",
+          static_cast<unsigned long long>(kSeed));
+  fprintf(file, "# toolchain: %s\n", toolchain().c_str());
+  for (const std::pair<const std::string, digest_map> &c : golden.digests_) {
+    for (const std::pair<const std::string, std::string> &d : c.second) {
+      fprintf(file, "digest|%s|%s|%s\n", c.first.c_str(), d.first.c_str(),
+              d.second.c_str());
+    }
+  }
+  for (const std::pair<const std::string, stats_map> &c : golden.stats_) {
+    for (const std::pair<const std::string, std::map<std::string, id_type>>
+             &h : c.second) {
+      fprintf(file, "stats|%s|%s|", c.first.c_str(), h.first.c_str());
+      for (const std::pair<const std::string, id_type> &e : h.second) {
+        fprintf(file, " %s:%llu", e.first.c_str(), e.second);
+      }
+      fprintf(file, "\n");
+    }
+  }
+  fclose(file);
+  return true;
+}
+
+bool readGolden(const std::string &path, golden_output *golden) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "Error: cannot open " << path << ".\n";
+    return false;
+  }
+  const std::string toolchain_prefix = "# toolchain: ";
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.compare(0, toolchain_prefix.size(), toolchain_prefix) == 0) {
+      golden->toolchain_ = line.substr(toolchain_prefix.size());
+    }
+    if (line.empty() || line[0] == '#') continue;
+    std::vector<std::string> fields;
+    boost::split(fields, line, boost::is_any_of("|"));
+    if (fields[0] == "digest" && fields.size() == 5) {
+      golden->digests_[fields[1]][fields[2]] = fields[3] + "|" + fields[4];
+    } else if (fields[0] == "stats" && fields.size() == 4) {
+      std::map<std::string, id_type> &hist =
+          golden->stats_[fields[1]][fields[2]];
+      std::vector<std::string> buckets;
+      boost::split(buckets, fields[3], boost::is_any_of(" "),
+                   boost::token_compress_on);
+      for (const std::string &bucket : buckets) {
+        const size_t colon = bucket.rfind(':');
+        if (colon == std::string::npos) continue;
+        hist[bucket.substr(0, colon)] =
+            std::strtoull(bucket.c_str() + colon + 1, NULL, 10);
+      }
+    } else {
+      std::cerr << "Error: invalid line in " << path << ": " << line << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::string mode = argc >= 2 ? argv[1] : "";
+  if (!((mode == "record" || mode == "check") && argc == 3) &&
+      !(mode == "test" && argc == 4)) {
+    std::cerr
+        << "Usage: bongard_regress record|check GOLDEN\n"
+           "       bongard_regress test GOLDEN LOCAL\n"
+           "Generate fixed-seed datasets. record writes the byte digests of "
+           "their files and\nthe histograms of their stats, generated by the "
+           "reference (one thread, no\nplacement kernels), to GOLDEN. check "
+           "generates them in every variant: the\nvariants that must not "
+           "change the output are compared byte by byte, the others\n(other "
+           "random engines and seeds) by the chi-square test of their "
+           "histograms.\ntest checks GOLDEN if it was recorded with the "
+           "toolchain of this build, and\notherwise LOCAL, which it records "
+           "on the first run.\n";
+    return 1;
+  }
+  std::string golden_path = argv[2];
+
+  golden_output golden;
+  if (mode != "record" && !readGolden(golden_path, &golden)) return 1;
+  if (mode == "test") {
+    mode = "check";
+    if (golden.toolchain_ != toolchain()) {
+      std::cout << golden_path << " was recorded with " << golden.toolchain_
+                << ", not " << toolchain() << ".\n";
+      golden_path = argv[3];
+      golden = golden_output();
+      if (!boost::filesystem::exists(golden_path) ||
+          !readGolden(golden_path, &golden) ||
+          golden.toolchain_ != toolchain()) {
+        std::cout << "Recording " << golden_path << ".\n";
+        mode = "record";
+        golden = golden_output();
+      }
+    }
+  }
+
+  const boost::filesystem::path work =
+      boost::filesystem::temp_directory_path() /
+      boost::filesystem::unique_path("bongard-regress-%%%%-%%%%-%%%%");
+
+  bool ok = true;
+  for (const generator_params &p : kInfeasibleParams) {
+    std::cout << "infeasible " << p.min_num_elems_ << "-" << p.max_num_elems_
+              << " elements, " << p.min_insides_ << " insides, bound "
+              << p.bound_ << ": ";
+    std::string reason;
+    if (p.feasible(&reason)) {
+      std::cout << "FAILED (accepted)\n";
+      ok = false;
+    } else {
+      std::cout << "OK (" << reason << ")\n";
+    }
+  }
+
+  // The peak RSS only grows, so the memory check comes first.
+  {
+    digest_map digests;
+    stats_map stats;
+    std::cout << kMemoryCase.name_ << " " << kMemoryVariant.name_ << ": "
+              << std::flush;
+    const long before = peakRSSKilobytes();
+    if (!generate(kMemoryCase, kMemoryVariant, work / kMemoryCase.name_,
+                  &digests, &stats)) {
+      std::cout << "FAILED to generate\n";
+      ok = false;
+    } else {
+      // The folds, the pending batches, the batches being generated and the
+      // output buffers.
+      const long growth = peakRSSKilobytes() - before;
+      const long limit = 6 * kMemoryBudget >> 10;
+      std::cout << (growth <= limit ? "OK" : "FAILED") << " (peak RSS +"
+                << growth << " KB, limit " << limit << " KB)\n";
+      ok = ok && growth <= limit;
+    }
+    boost::filesystem::remove_all(work / kMemoryCase.name_);
+  }
+
+  for (const regress_case &c : kCases) {
+    for (const regress_variant &v : kVariants) {
+      if (mode == "record" && std::string(v.name_) != "reference") continue;
+
+      digest_map digests;
+      stats_map stats;
+      std::cout << c.name_ << " " << v.name_ << ": " << std::flush;
+      if (!generate(c, v, work / c.name_, &digests, &stats)) {
+        std::cout << "FAILED to generate\n";
+        ok = false;
+        continue;
+      }
+
+      if (mode == "record") {
+        golden.digests_[c.name_] = digests;
+        golden.stats_[c.name_] = stats;
+        std::cout << digests.size() << " files\n";
+        continue;
+      }
+
+      std::vector<std::string> failures;
+      if (v.exact_) {
+        const digest_map &expected = golden.digests_[c.name_];
+        for (const std::pair<const std::string, std::string> &d : expected) {
+          digest_map::const_iterator it = digests.find(d.first);
+          if (it == digests.end()) {
+            failures.push_back(d.first + " is missing");
+          } else if (it->second != d.second) {
+            failures.push_back(d.first + " differs");
+          }
+        }
+        for (const std::pair<const std::string, std::string> &d : digests) {
+          if (expected.count(d.first) == 0) {
+            failures.push_back(d.first + " is new");
+          }
+        }
+      } else {
+        for (const std::pair<const std::string,
+                             std::map<std::string, id_type>> &h :
+             golden.stats_[c.name_]) {
+          std::string message;
+          if (!sameDistribution(h.second, stats[h.first], &message)) {
+            failures.push_back(h.first + " " + message);
+          }
+        }
+      }
+
+      if (failures.empty()) {
+        std::cout << "OK\n";
+      } else {
+        std::cout << "FAILED\n";
+        for (const std::string &failure : failures) {
+          std::cout << "  " << failure << "\n";
+        }
+        ok = false;
+      }
+    }
+  }
+  boost::filesystem::remove_all(work);
+
+  if (mode == "record" && !writeGolden(golden_path, golden)) return 1;
+  return ok ? 0 : 1;
+}
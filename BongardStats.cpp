@@ -0,0 +1,250 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Configurations.hpp"
+#include "DatasetStats.hpp"
+
+namespace {
+
+/** The size of the read buffer of the streaming parser. */
+const size_t kReadBufferSize = 1 << 20;
+
+/** The maximum number of columns of a scanned file. */
+const int kMaxColumns = 5;
+
+/**
+ * @brief Stream the rows of a '|'-separated id file.
+ *
+ * @param path The file to be scanned.
+ * @param ncols The number of columns in each row (at most kMaxColumns).
+ * @param f Called with the array of column values of every row.
+ * @return False if the file cannot be opened.
+ */
+template <typename Func>
+bool scanIds(const boost::filesystem::path &path, int ncols, Func f) {
+  FILE *file = fopen(path.c_str(), "r");
+  if (file == NULL) return false;
+
+  std::vector<char> buffer(kReadBufferSize);
+  id_type row[kMaxColumns] = {0};
+  id_type value = 0;
+  int col = 0;
+  bool pending = false;
+  size_t n;
+  while ((n = fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      char c = buffer[i];
+      if (c >= '0' && c <= '9') {
+        value = value * 10 + (c - '0');
+        pending = true;
+      } else if (c == '|') {
+        if (col < kMaxColumns) row[col] = value;
+        col++;
+        value = 0;
+      } else if (c == '\n') {
+        if (pending) {
+          if (col < kMaxColumns) row[col] = value;
+          if (col + 1 == ncols) f(row);
+        }
+        col = 0;
+        value = 0;
+        pending = false;
+      }
+    }
+  }
+  if (pending) {
+    if (col < kMaxColumns) row[col] = value;
+    if (col + 1 == ncols) f(row);
+  }
+  fclose(file);
+  return true;
+}
+
+/**
+ * @brief Compute the statistics of the fold in the directory \p dir.
+ */
+bool foldStats(const boost::filesystem::path &dir, bongard::DatasetStats *out) {
+  // The element ids and the picture ids are consecutive in a fold, so the
+  // per-element and per-picture counters are plain arrays.
+  std::vector<id_type> elem_pic;
+  std::vector<id_type> pic_elems;
+  id_type base_pid = 0;
+  id_type base_eid = 0;
+  bool contiguous = true;
+  bool found = scanIds(dir / "element", 2, [&](const id_type *row) {
+    if (elem_pic.empty()) {
+      base_pid = row[0];
+      base_eid = row[1];
+    }
+    if (row[1] != base_eid + elem_pic.size() || row[0] < base_pid ||
+        row[0] - base_pid > pic_elems.size()) {
+      contiguous = false;
+      return;
+    }
+    if (row[0] - base_pid == pic_elems.size()) pic_elems.push_back(0);
+    pic_elems[row[0] - base_pid]++;
+    elem_pic.push_back(row[0] - base_pid);
+  });
+  if (!found) {
+    std::cerr << "Error: cannot open " << (dir / "element").string() << ".\n";
+    return false;
+  }
+  if (!contiguous) {
+    std::cerr << "Error: the ids in " << (dir / "element").string()
+              << " are not consecutive.\n";
+    return false;
+  }
+
+  const size_t num_pics = pic_elems.size();
+  const size_t num_elems = elem_pic.size();
+  std::vector<id_type> shapes(bongard::kNumShapeTypes, 0);
+  std::vector<id_type> pic_insides(num_pics, 0);
+  std::vector<id_type> pic_norths(num_pics, 0);
+  std::vector<id_type> pic_easts(num_pics, 0);
+  std::vector<id_type> elem_depth(num_elems, 0);
+
+  // Every relation is scanned by its own thread into its own counters.
+  auto pairCounter = [&](const char *rel, std::vector<id_type> *pic_counts,
+                         std::vector<id_type> *first_counts) {
+    bool ok = scanIds(dir / rel, 2, [&](const id_type *row) {
+      id_type e = row[0] - base_eid;
+      if (e >= num_elems) return;
+      (*pic_counts)[elem_pic[e]]++;
+      if (first_counts != NULL) (*first_counts)[e]++;
+    });
+    if (!ok) {
+      std::cerr << "Warning: " << (dir / rel).string() << " is missing.\n";
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int s = 0; s < bongard::kNumShapeTypes; s++) {
+    threads.emplace_back([&, s]() {
+      const char *rel = bongard::shapeName(static_cast<bongard::ShapeType>(s));
+      scanIds(dir / rel, 1, [&](const id_type *) { shapes[s]++; });
+    });
+  }
+  threads.emplace_back(pairCounter, "inside", &pic_insides, &elem_depth);
+  if (boost::filesystem::exists(dir / "box")) {
+    // Coordinate encoding: count the north and east pairs from the boxes.
+    threads.emplace_back([&]() {
+      std::vector<int> left, bottom, right, top;
+      id_type pic = 0;
+      auto flush = [&]() {
+        pic_easts[pic] = bongard::countCoordinatePairs(left, right);
+        pic_norths[pic] = bongard::countCoordinatePairs(bottom, top);
+        left.clear();
+        bottom.clear();
+        right.clear();
+        top.clear();
+      };
+      scanIds(dir / "box", 5, [&](const id_type *row) {
+        id_type e = row[0] - base_eid;
+        if (e >= num_elems) return;
+        if (elem_pic[e] != pic) {
+          flush();
+          pic = elem_pic[e];
+        }
+        left.push_back(row[1]);
+        bottom.push_back(row[2]);
+        right.push_back(row[3]);
+        top.push_back(row[4]);
+      });
+      if (!left.empty()) flush();
+    });
+  } else {
+    threads.emplace_back(pairCounter, "north", &pic_norths, nullptr);
+    threads.emplace_back(pairCounter, "east", &pic_easts, nullptr);
+  }
+  for (std::thread &t : threads) t.join();
+
+  std::vector<id_type> pic_depth(num_pics, 0);
+  for (size_t e = 0; e < num_elems; e++) {
+    id_type &d = pic_depth[elem_pic[e]];
+    d = std::max(d, elem_depth[e]);
+  }
+
+  bongard::DatasetStats stats;
+  for (int s = 0; s < bongard::kNumShapeTypes; s++) {
+    stats.addShape(static_cast<bongard::ShapeType>(s), shapes[s]);
+  }
+  for (size_t p = 0; p < num_pics; p++) {
+    stats.addPicture(pic_elems[p], pic_insides[p], pic_norths[p],
+                     pic_easts[p], pic_depth[p]);
+  }
+
+  FILE *file = fopen((dir / "stats").c_str(), "w");
+  if (file == NULL) {
+    std::cerr << "Error: cannot write " << (dir / "stats").string() << ".\n";
+    return false;
+  }
+  stats.output(file);
+  fclose(file);
+
+  out->merge(stats);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::cerr
+        << "Usage: bongard_stats DIRECTORY\n"
+           "Compute the histograms of the folds under DIRECTORY (or of the "
+           "fold DIRECTORY itself)\nand write them to the file 'stats' of "
+           "each fold.\n";
+    return 0;
+  }
+
+  boost::filesystem::path root(argv[1]);
+  if (!boost::filesystem::is_directory(root)) {
+    std::cerr << "Error: " << argv[1] << " is not a directory.\n";
+    return 1;
+  }
+
+  std::vector<boost::filesystem::path> folds;
+  if (boost::filesystem::exists(root / "element")) {
+    folds.push_back(root);
+  } else {
+    for (boost::filesystem::directory_iterator it(root), end; it != end;
+         ++it) {
+      if (boost::filesystem::exists(it->path() / "element")) {
+        folds.push_back(it->path());
+      }
+    }
+    std::sort(folds.begin(), folds.end());
+  }
+
+  bongard::DatasetStats total;
+  for (const boost::filesystem::path &fold : folds) {
+    if (!foldStats(fold, &total)) return 1;
+    std::cout << "Scanned " << fold.string() << "." << std::endl;
+  }
+
+  total.output(stdout);
+  return 0;
+}
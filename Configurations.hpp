@@ -27,10 +27,28 @@ typedef long long unsigned int id_type;
 /** The chunk size of pictures stored in one fold */
 #define CUTOFF 1000000
 
+/**
+ * The number of pictures generated by one task. A batch draws from its own
+ * random engine seeded by the batch number, and batches are committed in
+ * order, so the output does not depend on the number of threads. It is the
+ * unit of scheduling: smaller batches balance the end of a run better, but
+ * seeding an engine takes about as long as drawing a small picture.
+ */
+#define BATCH_SIZE 128
+
+/**
+ * The number of consecutive duplicate pictures after which the generation
+ * fails, as the unique pictures are (nearly) exhausted.
+ */
+#define MAX_DUPLICATES 10000
+
+/** The number of rows of a block in the zone maps of a relation file. */
+#define ZONE_BLOCK_ROWS 65536
+
 /** Print the progress whenever a multiplier number of picture is generated. */
 #define PRINT_GRAN 5000
 
-/** The length and the width of the picture. */
+/** The default length and width of the picture (see --bound). */
 #define BOUND 100
 
 /** The minimum horizontal/vertical separate space between two elements and
@@ -41,4 +59,20 @@ typedef long long unsigned int id_type;
 /** The maximum number of trials in generating an element. */
 #define MAX_TRY 100000000
 
+/**
+ * The initial number of trials in generating an element. The budget of a
+ * picture is doubled, up to MAX_TRY, whenever an element cannot be placed
+ * and the picture is rolled back by one element.
+ */
+#define MIN_TRY 1000
+
+/**
+ * The maximum number of times a picture is rolled back by one element,
+ * instead of being generated from scratch, before it is given up.
+ */
+#define MAX_ROLLBACKS 64
+
+/** The default maximum number of element trials spent on one picture. */
+#define MAX_PICTURE_TRY 1000000000ULL
+
 #endif /* CONFIGURATIONS_HPP_ */
@@ -0,0 +1,89 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#include <cstdio>
+#include <map>
+
+#include "DatasetStats.hpp"
+
+namespace bongard {
+
+DatasetStats::DatasetStats() : num_pictures_(0) {
+  for (int i = 0; i < kNumShapeTypes; i++) shapes_[i] = 0;
+}
+
+void DatasetStats::addPicture(id_type num_elems, id_type num_insides,
+                              id_type num_norths, id_type num_easts,
+                              id_type depth) {
+  num_pictures_++;
+  elems_[num_elems]++;
+  insides_[num_insides]++;
+  norths_[num_norths]++;
+  easts_[num_easts]++;
+  depths_[depth]++;
+}
+
+void DatasetStats::addShape(ShapeType shape, id_type count) {
+  shapes_[shape] += count;
+}
+
+void DatasetStats::merge(const DatasetStats &other) {
+  num_pictures_ += other.num_pictures_;
+  for (const std::pair<const id_type, id_type> &e : other.elems_) {
+    elems_[e.first] += e.second;
+  }
+  for (const std::pair<const id_type, id_type> &e : other.insides_) {
+    insides_[e.first] += e.second;
+  }
+  for (const std::pair<const id_type, id_type> &e : other.norths_) {
+    norths_[e.first] += e.second;
+  }
+  for (const std::pair<const id_type, id_type> &e : other.easts_) {
+    easts_[e.first] += e.second;
+  }
+  for (const std::pair<const id_type, id_type> &e : other.depths_) {
+    depths_[e.first] += e.second;
+  }
+  for (int i = 0; i < kNumShapeTypes; i++) shapes_[i] += other.shapes_[i];
+}
+
+void DatasetStats::outputHistogram(FILE *file, const char *name,
+                                   const histogram &hist) {
+  fprintf(file, "%s:", name);
+  for (const std::pair<const id_type, id_type> &e : hist) {
+    fprintf(file, " %llu:%llu", e.first, e.second);
+  }
+  fprintf(file, "\n");
+}
+
+void DatasetStats::output(FILE *file) const {
+  fprintf(file, "#pictures: %llu\n", num_pictures_);
+  fprintf(file, "#shapes:");
+  for (int i = 0; i < kNumShapeTypes; i++) {
+    fprintf(file, " %s:%llu", shapeName(static_cast<ShapeType>(i)),
+            shapes_[i]);
+  }
+  fprintf(file, "\n");
+  outputHistogram(file, "#elements_per_picture", elems_);
+  outputHistogram(file, "#inside_per_picture", insides_);
+  outputHistogram(file, "#north_per_picture", norths_);
+  outputHistogram(file, "#east_per_picture", easts_);
+  outputHistogram(file, "#nesting_depth", depths_);
+}
+
+}  // namespace bongard
@@ -0,0 +1,85 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#ifndef DATASET_STATS_HPP_
+#define DATASET_STATS_HPP_
+
+#include <cstdio>
+#include <map>
+
+#include "BongardPicture.hpp"
+#include "Configurations.hpp"
+
+namespace bongard {
+
+/**
+ * @brief Per-picture distributions of a dataset.
+ * @details The statistics can be collected either from the in-memory
+ *          pictures at generation time or from the output files of a fold.
+ */
+class DatasetStats {
+ public:
+  DatasetStats();
+
+  /**
+   * @brief Account for one picture.
+   *
+   * @param num_elems The number of elements in the picture.
+   * @param num_insides The number of inside pairs in the picture.
+   * @param num_norths The number of north pairs in the picture.
+   * @param num_easts The number of east pairs in the picture.
+   * @param depth The maximum nesting depth of an element in the picture.
+   */
+  void addPicture(id_type num_elems, id_type num_insides, id_type num_norths,
+                  id_type num_easts, id_type depth);
+
+  /**
+   * @brief Account for \p count elements of the shape \p shape.
+   */
+  void addShape(ShapeType shape, id_type count = 1);
+
+  /**
+   * @brief Add the statistics of \p other into this one.
+   */
+  void merge(const DatasetStats &other);
+
+  inline id_type numPictures() const { return num_pictures_; }
+
+  /**
+   * @brief Write the histograms, one per line.
+   */
+  void output(FILE *file) const;
+
+ private:
+  typedef std::map<id_type, id_type> histogram;
+
+  static void outputHistogram(FILE *file, const char *name,
+                              const histogram &hist);
+
+  id_type num_pictures_;
+  histogram elems_;
+  histogram insides_;
+  histogram norths_;
+  histogram easts_;
+  histogram depths_;
+  id_type shapes_[kNumShapeTypes];
+};
+
+}  // namespace bongard
+
+#endif /* DATASET_STATS_HPP_ */
@@ -0,0 +1,70 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+
+#include "DuplicateFilter.hpp"
+
+namespace bongard {
+
+namespace {
+
+/** The maximum number of bits set per picture in a Bloom filter. */
+const int kMaxHashes = 16;
+
+}  // namespace
+
+DuplicateFilter::~DuplicateFilter() {}
+
+ConcurrentHashSet::ConcurrentHashSet() : shards_(new shard[kNumShards]) {}
+
+bool ConcurrentHashSet::insert(std::uint64_t hash) {
+  shard &s = shards_[hash >> 58];
+  std::lock_guard<std::mutex> lock(s.mutex_);
+  return s.hashes_.insert(hash).second;
+}
+
+BloomFilter::BloomFilter(std::uint64_t memory_bytes, std::uint64_t expected)
+    : num_bits_(std::max<std::uint64_t>(memory_bytes / 8, 1) * 64) {
+  // k = m / n * ln 2 minimizes the false positive rate.
+  const double k = static_cast<double>(num_bits_) /
+                   std::max<std::uint64_t>(expected, 1) * std::log(2.0);
+  num_hashes_ = std::max(1, std::min(kMaxHashes,
+                                     static_cast<int>(std::lround(k))));
+  words_.reset(new std::atomic<std::uint64_t>[num_bits_ / 64]);
+  for (std::uint64_t i = 0; i < num_bits_ / 64; i++) words_[i] = 0;
+}
+
+bool BloomFilter::insert(std::uint64_t hash) {
+  // Double hashing: the bits h1 + i * h2 for i < k.
+  const std::uint64_t h1 = hash;
+  const std::uint64_t h2 = mixHash(hash) | 1;
+  bool added = false;
+  for (int i = 0; i < num_hashes_; i++) {
+    const std::uint64_t bit = (h1 + i * h2) % num_bits_;
+    const std::uint64_t mask = 1ULL << (bit & 63);
+    if ((words_[bit >> 6].fetch_or(mask) & mask) == 0) added = true;
+  }
+  return added;
+}
+
+}  // namespace bongard
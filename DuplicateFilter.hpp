@@ -0,0 +1,108 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#ifndef DUPLICATE_FILTER_HPP_
+#define DUPLICATE_FILTER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace bongard {
+
+/**
+ * @brief The finalizer of splitmix64, which combines the values of a
+ *        canonical hash and derives the hashes of a Bloom filter.
+ */
+inline std::uint64_t mixHash(std::uint64_t h) {
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
+/**
+ * @brief A thread-safe set of picture hashes that rejects the pictures seen
+ *        before.
+ */
+class DuplicateFilter {
+ public:
+  virtual ~DuplicateFilter();
+
+  /**
+   * @brief Record a picture.
+   *
+   * @param hash The canonical hash of the picture.
+   * @return False if the picture was recorded before, or for a Bloom filter
+   *         may have been.
+   */
+  virtual bool insert(std::uint64_t hash) = 0;
+};
+
+/**
+ * @brief The exact set of the hashes, in shards that are locked separately.
+ * @details It takes about 40 bytes per unique picture.
+ */
+class ConcurrentHashSet : public DuplicateFilter {
+ public:
+  ConcurrentHashSet();
+
+  bool insert(std::uint64_t hash);
+
+ private:
+  static const int kNumShards = 64;
+
+  struct shard {
+    std::mutex mutex_;
+    std::unordered_set<std::uint64_t> hashes_;
+  };
+
+  std::unique_ptr<shard[]> shards_;
+};
+
+/**
+ * @brief A Bloom filter of a fixed memory budget.
+ * @details A unique picture is rejected with a probability that grows with
+ *          the number of pictures per bit; a duplicate is always rejected.
+ */
+class BloomFilter : public DuplicateFilter {
+ public:
+  /**
+   * @brief Constructor.
+   *
+   * @param memory_bytes The size of the bit array.
+   * @param expected The expected number of pictures, which sets the number
+   *                 of bits per picture.
+   */
+  BloomFilter(std::uint64_t memory_bytes, std::uint64_t expected);
+
+  bool insert(std::uint64_t hash);
+
+  inline int numHashes() const { return num_hashes_; }
+
+ private:
+  std::uint64_t num_bits_;
+  int num_hashes_;
+  std::unique_ptr<std::atomic<std::uint64_t>[]> words_;
+};
+
+}  // namespace bongard
+
+#endif /* DUPLICATE_FILTER_HPP_ */
@@ -0,0 +1,153 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#include <algorithm>
+#include <cmath>
+
+#include "Geometry.hpp"
+
+namespace bongard {
+
+namespace {
+
+inline double square(double v) { return v * v; }
+
+/**
+ * @return The distance from (px, py) to the boundary of the polygon \p g,
+ *         positive inside of it.
+ */
+inline double polygonDepth(const shape_geometry &g, double px, double py) {
+  double depth = g.nx_[0] * px + g.ny_[0] * py + g.c_[0];
+  for (int i = 1; i < g.n_; i++) {
+    depth = std::min(depth, g.nx_[i] * px + g.ny_[i] * py + g.c_[i]);
+  }
+  return depth;
+}
+
+inline double segmentDistance2(double px, double py, double ax, double ay,
+                               double bx, double by) {
+  const double ex = bx - ax;
+  const double ey = by - ay;
+  const double len2 = ex * ex + ey * ey;
+  double t = len2 > 0 ? ((px - ax) * ex + (py - ay) * ey) / len2 : 0;
+  t = std::max(0.0, std::min(1.0, t));
+  return square(px - ax - t * ex) + square(py - ay - t * ey);
+}
+
+/**
+ * @return The squared distance from (px, py) to the boundary of the polygon
+ *         \p g.
+ */
+double boundaryDistance2(const shape_geometry &g, double px, double py) {
+  double dist2 = INFINITY;
+  for (int i = 0; i < g.n_; i++) {
+    const int j = i + 1 == g.n_ ? 0 : i + 1;
+    dist2 = std::min(dist2, segmentDistance2(px, py, g.x_[i], g.y_[i],
+                                             g.x_[j], g.y_[j]));
+  }
+  return dist2;
+}
+
+/**
+ * @return The largest distance by which an edge of \p a separates the
+ *         vertices of \p b, negative if no edge separates them.
+ */
+double edgeSeparation(const shape_geometry &a, const shape_geometry &b) {
+  double separation = -INFINITY;
+  for (int i = 0; i < a.n_; i++) {
+    double depth = a.nx_[i] * b.x_[0] + a.ny_[i] * b.y_[0] + a.c_[i];
+    for (int k = 1; k < b.n_; k++) {
+      depth = std::max(depth, a.nx_[i] * b.x_[k] + a.ny_[i] * b.y_[k] +
+                                  a.c_[i]);
+    }
+    separation = std::max(separation, -depth);
+  }
+  return separation;
+}
+
+}  // namespace
+
+void shape_geometry::setEdges() {
+  for (int i = 0; i < n_; i++) {
+    const int j = i + 1 == n_ ? 0 : i + 1;
+    const double ex = x_[j] - x_[i];
+    const double ey = y_[j] - y_[i];
+    const double len = ex == 0 || ey == 0 ? std::abs(ex) + std::abs(ey)
+                                          : std::sqrt(ex * ex + ey * ey);
+    nx_[i] = -ey / len;
+    ny_[i] = ex / len;
+    c_[i] = -(nx_[i] * x_[i] + ny_[i] * y_[i]);
+  }
+}
+
+bool shapeInside(const shape_geometry &a, const shape_geometry &b,
+                 double margin) {
+  if (b.disc_) {
+    const double limit = b.r_ - margin - (a.disc_ ? a.r_ : 0);
+    if (limit < 0) return false;
+    if (a.disc_) {
+      return square(a.cx_ - b.cx_) + square(a.cy_ - b.cy_) <= square(limit);
+    }
+    for (int i = 0; i < a.n_; i++) {
+      if (square(a.x_[i] - b.cx_) + square(a.y_[i] - b.cy_) > square(limit)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  if (a.disc_) return polygonDepth(b, a.cx_, a.cy_) >= a.r_ + margin;
+  for (int i = 0; i < a.n_; i++) {
+    if (polygonDepth(b, a.x_[i], a.y_[i]) < margin) return false;
+  }
+  return true;
+}
+
+bool shapeSeparated(const shape_geometry &a, const shape_geometry &b,
+                    double margin) {
+  if (a.disc_ && b.disc_) {
+    return square(a.cx_ - b.cx_) + square(a.cy_ - b.cy_) >
+           square(a.r_ + b.r_ + margin);
+  }
+  if (a.disc_ || b.disc_) {
+    const shape_geometry &disc = a.disc_ ? a : b;
+    const shape_geometry &poly = a.disc_ ? b : a;
+    const double reach = disc.r_ + margin;
+    const double depth = polygonDepth(poly, disc.cx_, disc.cy_);
+    if (depth >= 0) return false;
+    if (-depth > reach) return true;
+    return boundaryDistance2(poly, disc.cx_, disc.cy_) > square(reach);
+  }
+
+  // Convex polygons intersect iff no edge separates them; otherwise the
+  // closest points include a vertex of one of them.
+  const double separation = std::max(edgeSeparation(a, b),
+                                     edgeSeparation(b, a));
+  if (separation > margin) return true;
+  if (separation <= 0) return false;
+  const double reach2 = square(margin);
+  for (int i = 0; i < a.n_; i++) {
+    if (boundaryDistance2(b, a.x_[i], a.y_[i]) <= reach2) return false;
+  }
+  for (int i = 0; i < b.n_; i++) {
+    if (boundaryDistance2(a, b.x_[i], b.y_[i]) <= reach2) return false;
+  }
+  return true;
+}
+
+}  // namespace bongard
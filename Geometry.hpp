@@ -0,0 +1,69 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#ifndef GEOMETRY_HPP_
+#define GEOMETRY_HPP_
+
+namespace bongard {
+
+/**
+ * @brief The exact shape of an element: a disc, or a convex polygon with
+ *        its vertices in counter-clockwise order.
+ */
+struct shape_geometry {
+  /** True for a disc of center (cx_, cy_) and radius r_. */
+  bool disc_;
+  double cx_;
+  double cy_;
+  double r_;
+
+  /** The number of vertices of a polygon. */
+  int n_;
+  double x_[4];
+  double y_[4];
+
+  /**
+   * The inner unit normal of the edge from vertex i to vertex i + 1 and its
+   * offset: nx_[i] * x + ny_[i] * y + c_[i] is the distance of (x, y) to the
+   * line of the edge, positive on the inner side.
+   */
+  double nx_[4];
+  double ny_[4];
+  double c_[4];
+
+  /** Compute the edge normals of a polygon once its vertices are set. */
+  void setEdges();
+};
+
+/**
+ * @brief Test whether the shape \p a is inside of the shape \p b with a
+ *        separate space of at least \p margin.
+ */
+bool shapeInside(const shape_geometry &a, const shape_geometry &b,
+                 double margin);
+
+/**
+ * @brief Test whether the distance between the shapes \p a and \p b is
+ *        greater than \p margin.
+ */
+bool shapeSeparated(const shape_geometry &a, const shape_geometry &b,
+                    double margin);
+
+}  // namespace bongard
+
+#endif /* GEOMETRY_HPP_ */
@@ -16,55 +16,336 @@
  * @author Qiang Zeng <qzeng@cs.wisc.edu>
  **/
 
+#include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
 #include <climits>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "BongardGenerator.hpp"
+#include "Configurations.hpp"
+#include "DuplicateFilter.hpp"
+#include "ParameterSweep.hpp"
+
+namespace po = boost::program_options;
+
+namespace {
+
+/**
+ * @brief Create the duplicate filter of the kind \p dedup.
+ *
+ * @param memory_bytes The memory budget of a Bloom filter.
+ * @param expected The number of pictures to be generated.
+ * @param filter Set to the filter, or to NULL for none.
+ * @return False if \p dedup is not a valid kind.
+ */
+bool makeDuplicateFilter(const std::string &dedup,
+                         unsigned long long memory_bytes,
+                         unsigned long long expected,
+                         std::shared_ptr<bongard::DuplicateFilter> *filter) {
+  if (dedup == "none") {
+    filter->reset();
+  } else if (dedup == "exact") {
+    filter->reset(new bongard::ConcurrentHashSet());
+  } else if (dedup == "bloom") {
+    bongard::BloomFilter *bloom =
+        new bongard::BloomFilter(memory_bytes, expected);
+    filter->reset(bloom);
+    std::cout << "Bloom filter of " << (memory_bytes >> 20) << " MB with "
+              << bloom->numHashes() << " hashes per picture.\n";
+  } else {
+    std::cerr << "Error: " << dedup << " is not a valid duplicate filter.\n";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
 
 int main(int argc, char **argv) {
-  if (argc != 3) {
+  std::string num_arg;
+  std::string dir_arg;
+  std::string layout_arg;
+  std::string encoding_arg;
+  std::string sweep_arg;
+  std::string dedup_arg;
+  std::string invariance_arg;
+  std::string io_arg;
+  std::string rng_arg;
+  int min_num_elements;
+  int max_num_elements;
+  int min_length;
+  int max_length;
+  int min_encolse_pairs;
+  int bound;
+  int num_threads;
+  int prolog_shards;
+
+  po::options_description options("Options");
+  options.add_options()
+      ("help,h", "Print this message.")
+      ("min-elements", po::value<int>(&min_num_elements)->default_value(4),
+       "The minimum number of elements in a picture.")
+      ("max-elements", po::value<int>(&max_num_elements)->default_value(6),
+       "The maximum number of elements in a picture.")
+      ("min-size", po::value<int>(&min_length)->default_value(2),
+       "The minimum size of an element.")
+      ("max-size", po::value<int>(&max_length)->default_value(98),
+       "The maximum size of an element.")
+      ("min-insides", po::value<int>(&min_encolse_pairs)->default_value(1),
+       "The minimum number of pairs of elements for which one is enclosed "
+       "in the other.")
+      ("bound", po::value<int>(&bound)->default_value(BOUND),
+       "The length and the width of a picture.")
+      ("layout", po::value<std::string>(&layout_arg)->default_value("text"),
+       "Comma-separated output layouts of a fold: text (one file per "
+       "relation), csr (one binary adjacency record per picture) and prolog "
+       "(facts, mode declarations and examples for Aleph).")
+      ("prolog-shards", po::value<int>(&prolog_shards)->default_value(1),
+       "The number of files the Prolog facts of a fold are split into.")
+      ("large-pictures",
+       "Compute the relations by sorting and sweeping the bounding boxes "
+       "instead of testing all pairs of elements.")
+      ("relation-encoding",
+       po::value<std::string>(&encoding_arg)->default_value("pairs"),
+       "The encoding of north and east: pairs, or coordinates (one bounding "
+       "box per element in the file 'box' and in the CSR records).")
+      ("generic",
+       "Do not use the placement kernels specialized for the picture bound "
+       "and the maximum number of elements.")
+      ("max-picture-trials",
+       po::value<unsigned long long>()->default_value(MAX_PICTURE_TRY),
+       "Fail when a picture cannot be generated with this number of element "
+       "trials.")
+      ("forest",
+       "Also output the containment forest: the files 'directly_inside' "
+       "(element|parent) and 'depth' (element|nesting depth).")
+      ("sorted",
+       "Order the rows of every relation file of a fold by the first and "
+       "then the second ID column, and write the zone maps of the files "
+       "('zonemap' per file and 'zonemap_blocks' per block of rows).")
+      ("io", po::value<std::string>(&io_arg)->default_value("buffered"),
+       "How the relation files are written: buffered, fadvise (drop the "
+       "written pages from the page cache) or direct (O_DIRECT).")
+      ("exact-geometry",
+       "Test whether elements overlap or enclose each other by their exact "
+       "shapes instead of their bounding rectangles.")
+      ("dedup", po::value<std::string>(&dedup_arg)->default_value("none"),
+       "Drop the pictures equal to a generated one by their canonical hash: "
+       "none, exact (a hash set, about 40 bytes per picture) or bloom (a "
+       "Bloom filter of --dedup-memory, which may also drop a few unique "
+       "pictures).")
+      ("dedup-invariance",
+       po::value<std::string>(&invariance_arg)->default_value("none"),
+       "Comma-separated transformations under which pictures are equal: "
+       "none, translation and reflection.")
+      ("dedup-memory",
+       po::value<unsigned long long>()->default_value(1024),
+       "The memory of the Bloom filter in MB.")
+      ("memory-budget",
+       po::value<unsigned long long>()->default_value(0),
+       "Write a fold when its pictures hold this number of MB (0: when it "
+       "has CUTOFF pictures).")
+      ("seed", po::value<unsigned long long>(),
+       "The seed of the random engines (default: drawn from "
+       "std::random_device); it is recorded in the summary of every fold.")
+      ("rng", po::value<std::string>(&rng_arg)->default_value("mt19937"),
+       "The random engine: mt19937 (the reference), mt19937_64 or "
+       "splitmix64.")
+      ("threads",
+       po::value<int>(&num_threads)->default_value(
+           bongard::generator_options().num_threads_),
+       "The number of threads generating pictures.")
+      ("sweep", po::value<std::string>(&sweep_arg),
+       "Generate every configuration of the file into its own directory "
+       "under DIRECTORY; each line is NAME NUM_PICTURES MIN_ELEMENTS "
+       "MAX_ELEMENTS MIN_SIZE MAX_SIZE MIN_INSIDES [BOUND].");
+  po::options_description hidden;
+  hidden.add_options()
+      ("num", po::value<std::string>(&num_arg))
+      ("dir", po::value<std::string>(&dir_arg));
+  po::options_description all;
+  all.add(options).add(hidden);
+  po::positional_options_description positional;
+  positional.add("num", 1).add("dir", 1);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv)
+                  .options(all)
+                  .positional(positional)
+                  .run(),
+              vm);
+    po::notify(vm);
+  } catch (const po::error &e) {
+    std::cerr << "Error: " << e.what() << ".\n";
+    return 1;
+  }
+
+  if (vm.count("sweep") && vm.count("num") && !vm.count("dir")) {
+    // The only positional argument of a sweep is the directory.
+    dir_arg = num_arg;
+    vm.erase("num");
+  }
+
+  if (vm.count("help") || (!vm.count("sweep") && !vm.count("num")) ||
+      dir_arg.empty()) {
     std::cerr
-        << "Usage: bongard_generator NUM_PCITURES DIRECTORY\n"
-           "Create NUM_PICTURES Bongard pictures in the directory DIRECTORY\n";
+        << "Usage: bongard_generator [OPTIONS] NUM_PCITURES DIRECTORY\n"
+           "       bongard_generator [OPTIONS] --sweep=FILE DIRECTORY\n"
+           "Create NUM_PICTURES Bongard pictures in the directory DIRECTORY\n"
+        << options;
     return 0;
   }
 
-  boost::filesystem::path root(argv[2]);
+  boost::filesystem::path root(dir_arg);
   if (!boost::filesystem::exists(root)) {
-    std::cerr << "Error: The path " << argv[2] << " does not exists.\n";
+    std::cerr << "Error: The path " << dir_arg << " does not exists.\n";
     return 0;
   }
   if (!boost::filesystem::is_directory(root)) {
-    std::cerr << "Error: " << argv[2] << " is not a directory.\n";
+    std::cerr << "Error: " << dir_arg << " is not a directory.\n";
     return 0;
   }
 
+  bongard::generator_options opts;
+  opts.layout_ = 0;
+  std::vector<std::string> layouts;
+  boost::split(layouts, layout_arg, boost::is_any_of(","));
+  for (const std::string &layout : layouts) {
+    if (layout == "text") {
+      opts.layout_ |= bongard::kLayoutText;
+    } else if (layout == "csr") {
+      opts.layout_ |= bongard::kLayoutCSR;
+    } else if (layout == "prolog") {
+      opts.layout_ |= bongard::kLayoutProlog;
+    } else {
+      std::cerr << "Error: " << layout << " is not a valid layout.\n";
+      return 1;
+    }
+  }
+
+  opts.large_pictures_ = vm.count("large-pictures") > 0;
+  opts.forest_ = vm.count("forest") > 0;
+  opts.sorted_ = vm.count("sorted") > 0;
+  opts.kernels_ = vm.count("generic") == 0;
+  opts.max_picture_trials_ = vm["max-picture-trials"].as<unsigned long long>();
+  opts.num_threads_ = num_threads;
+  if (encoding_arg == "pairs") {
+    opts.encoding_ = bongard::kEncodingPairs;
+  } else if (encoding_arg == "coordinates") {
+    opts.encoding_ = bongard::kEncodingCoordinates;
+  } else {
+    std::cerr << "Error: " << encoding_arg << " is not a valid encoding.\n";
+    return 1;
+  }
+  if (io_arg == "buffered") {
+    opts.io_ = bongard::kIOBuffered;
+  } else if (io_arg == "fadvise") {
+    opts.io_ = bongard::kIOAdvise;
+  } else if (io_arg == "direct") {
+    opts.io_ = bongard::kIODirect;
+  } else {
+    std::cerr << "Error: " << io_arg << " is not a valid I/O mode.\n";
+    return 1;
+  }
+
+  opts.dedup_invariance_ = bongard::kInvariantNone;
+  std::vector<std::string> invariances;
+  boost::split(invariances, invariance_arg, boost::is_any_of(","));
+  for (const std::string &invariance : invariances) {
+    if (invariance == "translation") {
+      opts.dedup_invariance_ |= bongard::kInvariantTranslation;
+    } else if (invariance == "reflection") {
+      opts.dedup_invariance_ |= bongard::kInvariantReflection;
+    } else if (invariance != "none") {
+      std::cerr << "Error: " << invariance << " is not a valid invariance.\n";
+      return 1;
+    }
+  }
+  const unsigned long long dedup_memory =
+      vm["dedup-memory"].as<unsigned long long>();
+
+  if (prolog_shards < 1) {
+    std::cerr << "Error: " << prolog_shards << " is not a valid number of "
+              << "shards.\n";
+    return 1;
+  }
+  opts.prolog_shards_ = prolog_shards;
+  opts.memory_budget_ = vm["memory-budget"].as<unsigned long long>() << 20;
+  if (vm.count("seed")) {
+    opts.seeded_ = true;
+    opts.seed_ = vm["seed"].as<unsigned long long>();
+  }
+  if (rng_arg == "mt19937") {
+    opts.engine_ = bongard::kEngineMT19937;
+  } else if (rng_arg == "mt19937_64") {
+    opts.engine_ = bongard::kEngineMT19937_64;
+  } else if (rng_arg == "splitmix64") {
+    opts.engine_ = bongard::kEngineSplitMix64;
+  } else {
+    std::cerr << "Error: " << rng_arg << " is not a valid random engine.\n";
+    return 1;
+  }
+
+  if (num_threads < 1) {
+    std::cerr << "Error: " << num_threads << " is not a valid number of "
+              << "threads.\n";
+    return 1;
+  }
+
+  if (vm.count("sweep")) {
+    std::vector<bongard::sweep_config> configs;
+    if (!bongard::readSweepConfigs(sweep_arg, vm.count("exact-geometry") > 0,
+                                   &configs)) {
+      return 1;
+    }
+    // Every configuration has its own filter, with its share of the memory
+    // of a Bloom filter, so that its duplicates do not depend on the timing
+    // of the others.
+    unsigned long long total = 0;
+    for (const bongard::sweep_config &config : configs) total += config.num_;
+    for (bongard::sweep_config &config : configs) {
+      const unsigned long long memory_bytes = static_cast<unsigned long long>(
+          static_cast<double>(dedup_memory << 20) * config.num_ / total);
+      if (!makeDuplicateFilter(dedup_arg, memory_bytes, config.num_,
+                               &config.dedup_)) {
+        return 1;
+      }
+    }
+    return bongard::runSweep(configs, root.string(), opts) ? 0 : 1;
+  }
+
   char *pend;
-  unsigned long long int num_pics = std::strtoull(argv[1], &pend, 10);
+  unsigned long long int num_pics = std::strtoull(num_arg.c_str(), &pend, 10);
   if (num_pics == 0ULL || num_pics == ULLONG_MAX) {
-    std::cerr << "Error: " << argv[1] << " is not a valid input number.\n";
+    std::cerr << "Error: " << num_arg << " is not a valid input number.\n";
     return 0;
   }
 
-  /**
-   * Change the other five parameters to custom the generator.
-   */
-  int min_num_elements = 4;
-  int max_num_elements = 6;
-  int min_length = 2;
-  int max_length = 98;
-  int min_encolse_pairs = 1;
+  if (min_num_elements < 0 || max_num_elements < min_num_elements ||
+      min_length < 1 || max_length < min_length || bound <= 2 * MARGIN) {
+    std::cerr << "Error: invalid generator parameters.\n";
+    return 1;
+  }
 
   bongard::generator_params param(min_num_elements,
                                   max_num_elements,
                                   min_length,
                                   max_length,
-                                  min_encolse_pairs);
+                                  min_encolse_pairs,
+                                  bound,
+                                  vm.count("exact-geometry") > 0);
 
-  bongard::BongardGenerator gen(param, root.string());
-  gen.generate(num_pics);
+  if (!makeDuplicateFilter(dedup_arg, dedup_memory << 20, num_pics,
+                           &opts.dedup_)) {
+    return 1;
+  }
 
-  return 0;
+  bongard::BongardGenerator gen(param, root.string(), 0, 0, 0, opts);
+  return gen.generate(num_pics) ? 0 : 1;
 }
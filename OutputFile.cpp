@@ -0,0 +1,165 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#include <boost/filesystem.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "OutputFile.hpp"
+
+namespace bongard {
+
+namespace {
+
+/** The alignment of the buffer, the sizes and the offsets of the writes. */
+const size_t kPageSize = 4096;
+
+}  // namespace
+
+const size_t OutputFile::kBufferSize;
+
+OutputFile::OutputFile(const boost::filesystem::path &path, io_mode io)
+    : path_(path.string()),
+      io_(io),
+      fd_(-1),
+      storage_(new char[kBufferSize + kPageSize]),
+      buffer_(NULL),
+      size_(0),
+      written_(0),
+      advised_(0) {
+  const uintptr_t address = reinterpret_cast<uintptr_t>(storage_.get());
+  buffer_ = storage_.get() + (kPageSize - address % kPageSize) % kPageSize;
+
+  const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+  if (io_ == kIODirect) fd_ = ::open(path_.c_str(), flags | O_DIRECT, 0644);
+#endif
+  if (fd_ < 0) {
+    if (io_ == kIODirect) io_ = kIOBuffered;
+    fd_ = ::open(path_.c_str(), flags, 0644);
+  }
+  if (fd_ < 0) {
+    std::cerr << "Error: cannot open " << path_ << ".\n";
+    return;
+  }
+#ifdef POSIX_FADV_SEQUENTIAL
+  if (io_ == kIOAdvise) posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+OutputFile::~OutputFile() { close(); }
+
+void OutputFile::append(id_type value) {
+  char digits[20];
+  int n = 0;
+  do {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value != 0);
+  while (n > 0) buffer_[size_++] = digits[--n];
+}
+
+void OutputFile::append(int value) {
+  if (value < 0) {
+    buffer_[size_++] = '-';
+    append(static_cast<id_type>(-static_cast<long long>(value)));
+  } else {
+    append(static_cast<id_type>(value));
+  }
+}
+
+void OutputFile::flush(bool last) {
+  const size_t size = last ? size_ : size_ / kPageSize * kPageSize;
+  if (size == 0) return;
+
+  if (fd_ >= 0) {
+    const off_t offset = written_;
+    size_t length = size;
+    if (io_ == kIODirect && size % kPageSize != 0) {
+      // The tail is padded to a whole page and cut off again by ftruncate.
+      length = (size + kPageSize - 1) / kPageSize * kPageSize;
+      std::fill(buffer_ + size, buffer_ + length, 0);
+    }
+    if (writeAll(buffer_, length) && length != size) {
+      if (ftruncate(fd_, offset + size) != 0) {
+        std::cerr << "Error: cannot truncate " << path_ << ".\n";
+      }
+    }
+#if defined(POSIX_FADV_DONTNEED) && defined(SYNC_FILE_RANGE_WRITE)
+    if (io_ == kIOAdvise && fd_ >= 0) {
+      // Start the write-back of this write and drop the pages of the earlier
+      // ones, which are clean by now unless the device is behind.
+      // A length of 0 would advise to the end of the file, including the
+      // pages just written, so the first write advises nothing.
+      sync_file_range(fd_, offset, size, SYNC_FILE_RANGE_WRITE);
+      if (offset > advised_) {
+        posix_fadvise(fd_, advised_, offset - advised_, POSIX_FADV_DONTNEED);
+        advised_ = offset;
+      }
+    }
+#endif
+  }
+
+  written_ += size;
+  size_ -= size;
+  std::memmove(buffer_, buffer_ + size, size_);
+}
+
+bool OutputFile::writeAll(const char *data, size_t size) {
+  while (size > 0) {
+    const ssize_t written = ::write(fd_, data, size);
+    if (written < 0 && errno == EINTR) continue;
+#ifdef O_DIRECT
+    if (written < 0 && errno == EINVAL && io_ == kIODirect) {
+      // The file system accepted O_DIRECT on open but not on write.
+      fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+      io_ = kIOBuffered;
+      continue;
+    }
+#endif
+    if (written <= 0) {
+      std::cerr << "Error: cannot write " << path_ << ".\n";
+      ::close(fd_);
+      fd_ = -1;
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+void OutputFile::close() {
+  if (fd_ < 0) return;
+  flush(true);
+#ifdef POSIX_FADV_DONTNEED
+  if (io_ == kIOAdvise && fd_ >= 0) {
+    posix_fadvise(fd_, advised_, 0, POSIX_FADV_DONTNEED);
+  }
+#endif
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+}
+
+}  // namespace bongard
@@ -0,0 +1,120 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#ifndef OUTPUT_FILE_HPP_
+#define OUTPUT_FILE_HPP_
+
+#include <boost/filesystem.hpp>
+#include <sys/types.h>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "Configurations.hpp"
+
+namespace bongard {
+
+/**
+ * @brief How the output files are written.
+ */
+enum io_mode {
+  /** Through the page cache. */
+  kIOBuffered = 0,
+  /** Through the page cache, dropping the written pages (posix_fadvise). */
+  kIOAdvise,
+  /**
+   * Bypassing the page cache (O_DIRECT); falls back to kIOBuffered where the
+   * file system does not support it.
+   */
+  kIODirect
+};
+
+/**
+ * @brief A file written through an aligned buffer.
+ * @details The text is formatted into the buffer, which is written in
+ *          multiples of the page size until the file is closed.
+ */
+class OutputFile {
+ public:
+  /** The size of the buffer, a multiple of the page size. */
+  static const size_t kBufferSize = 4 << 20;
+
+  /**
+   * @brief Constructor.
+   *
+   * @param path The path of the file, which is truncated.
+   * @param io How the file is written.
+   */
+  explicit OutputFile(const boost::filesystem::path &path,
+                      io_mode io = kIOBuffered);
+
+  ~OutputFile();
+
+  /**
+   * @brief Make room for \p size bytes, which must be less than kBufferSize
+   *        minus a page.
+   */
+  inline void reserve(size_t size) {
+    if (size_ + size > kBufferSize) flush(false);
+  }
+
+  /** The put and append methods need room, see reserve. */
+  inline void put(char c) { buffer_[size_++] = c; }
+
+  inline void put(const char *text, size_t size) {
+    std::memcpy(buffer_ + size_, text, size);
+    size_ += size;
+  }
+
+  inline void put(const std::string &text) { put(text.data(), text.size()); }
+
+  void append(id_type value);
+  void append(int value);
+
+  /**
+   * @return The number of bytes put into the file.
+   */
+  inline id_type offset() const { return written_ + size_; }
+
+  /**
+   * @brief Flush and close the file.
+   */
+  void close();
+
+ private:
+  /**
+   * @brief Write the whole pages of the buffer, or everything if \p last.
+   */
+  void flush(bool last);
+  bool writeAll(const char *data, size_t size);
+
+  std::string path_;
+  io_mode io_;
+  int fd_;
+  /** Not initialized, so that the pages are only resident once used. */
+  std::unique_ptr<char[]> storage_;
+  char *buffer_;
+  size_t size_;
+  id_type written_;
+  /** The bytes before this offset have been dropped from the page cache. */
+  off_t advised_;
+};
+
+}  // namespace bongard
+
+#endif /* OUTPUT_FILE_HPP_ */
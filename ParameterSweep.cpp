@@ -0,0 +1,120 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BongardGenerator.hpp"
+#include "Configurations.hpp"
+#include "ParameterSweep.hpp"
+#include "ThreadPool.hpp"
+
+namespace bongard {
+
+bool readSweepConfigs(const std::string &path, bool exact_geometry,
+                      std::vector<sweep_config> *configs) {
+  std::ifstream in(path.c_str());
+  if (!in) {
+    std::cerr << "Error: cannot open the sweep file " << path << ".\n";
+    return false;
+  }
+
+  std::set<std::string> names;
+  std::string line;
+  for (int line_no = 1; std::getline(in, line); line_no++) {
+    std::istringstream str(line);
+    std::string name;
+    if (!(str >> name) || name[0] == '#') continue;
+
+    unsigned long long num;
+    int min_elems, max_elems, min_size, max_size, min_insides;
+    int bound = BOUND;
+    if (!(str >> num >> min_elems >> max_elems >> min_size >> max_size >>
+          min_insides)) {
+      std::cerr << "Error: " << path << ":" << line_no
+                << ": expected NAME NUM_PICTURES MIN_ELEMENTS MAX_ELEMENTS "
+                   "MIN_SIZE MAX_SIZE MIN_INSIDES [BOUND].\n";
+      return false;
+    }
+    str >> bound;
+
+    if (num == 0 || min_elems < 0 || max_elems < min_elems || min_size < 1 ||
+        max_size < min_size || bound <= 2 * MARGIN) {
+      std::cerr << "Error: " << path << ":" << line_no
+                << ": invalid generator parameters.\n";
+      return false;
+    }
+    if (!names.insert(name).second) {
+      std::cerr << "Error: " << path << ":" << line_no
+                << ": duplicate configuration " << name << ".\n";
+      return false;
+    }
+
+    configs->emplace_back(name, num,
+                          generator_params(min_elems, max_elems, min_size,
+                                           max_size, min_insides, bound,
+                                           exact_geometry));
+  }
+
+  if (configs->empty()) {
+    std::cerr << "Error: no configuration in " << path << ".\n";
+    return false;
+  }
+  return true;
+}
+
+bool runSweep(const std::vector<sweep_config> &configs,
+              const std::string &root_path, const generator_options &opts) {
+  std::vector<std::unique_ptr<BongardGenerator>> gens;
+  for (size_t i = 0; i < configs.size(); i++) {
+    boost::filesystem::path dir(root_path);
+    dir /= configs[i].name_;
+    boost::filesystem::create_directories(dir);
+    // The configurations of a seeded sweep are seeded in their order.
+    generator_options config_opts = opts;
+    config_opts.seed_ += i;
+    config_opts.dedup_ = configs[i].dedup_;
+    gens.emplace_back(new BongardGenerator(configs[i].p_, dir.string(), 0, 0,
+                                           0, config_opts));
+  }
+
+  bool ok = true;
+  std::vector<bool> scheduled(configs.size());
+  ThreadPool pool(opts.num_threads_);
+  for (size_t i = 0; i < configs.size(); i++) {
+    std::cout << configs[i].name_ << ": " << std::flush;
+    scheduled[i] = gens[i]->schedule(configs[i].num_, &pool);
+    ok = ok && scheduled[i];
+  }
+  pool.wait();
+
+  for (size_t i = 0; i < configs.size(); i++) {
+    if (!scheduled[i]) continue;
+    std::cout << configs[i].name_ << ": " << std::flush;
+    ok = gens[i]->finish() && ok;
+  }
+  return ok;
+}
+
+}  // namespace bongard
@@ -0,0 +1,78 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#ifndef PARAMETER_SWEEP_HPP_
+#define PARAMETER_SWEEP_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BongardGenerator.hpp"
+#include "Configurations.hpp"
+#include "DuplicateFilter.hpp"
+
+namespace bongard {
+
+/**
+ * @brief One configuration of a parameter sweep.
+ */
+struct sweep_config {
+  sweep_config(const std::string &name, id_type num, generator_params p)
+      : name_(name), num_(num), p_(p) {}
+
+  /** The sub-directory of the sweep root the configuration is written to. */
+  std::string name_;
+  id_type num_;
+  generator_params p_;
+  /** The duplicate filter of the configuration, if any. */
+  std::shared_ptr<DuplicateFilter> dedup_;
+};
+
+/**
+ * @brief Read the configurations of a sweep.
+ * @details Every non-empty line not starting with '#' is
+ *          "NAME NUM_PICTURES MIN_ELEMENTS MAX_ELEMENTS MIN_SIZE MAX_SIZE
+ *          MIN_INSIDES [BOUND]".
+ *
+ * @param path The configuration file.
+ * @param exact_geometry Whether every configuration uses exact geometry.
+ * @param configs The configurations read.
+ * @return False (with a message on stderr) if the file is malformed.
+ */
+bool readSweepConfigs(const std::string &path, bool exact_geometry,
+                      std::vector<sweep_config> *configs);
+
+/**
+ * @brief Generate every configuration into its own directory under
+ *        \p root_path.
+ * @details The batches of all configurations are run by one thread pool of
+ *          opts.num_threads_ threads, so a small configuration does not
+ *          leave threads idle while a large one is still running. The
+ *          configurations are seeded with opts.seed_, opts.seed_ + 1, ... and
+ *          take their duplicate filters from sweep_config::dedup_ rather
+ *          than from opts.
+ *
+ * @return False if a configuration is infeasible or could not be generated.
+ */
+bool runSweep(const std::vector<sweep_config> &configs,
+              const std::string &root_path, const generator_options &opts);
+
+}  // namespace bongard
+
+#endif /* PARAMETER_SWEEP_HPP_ */
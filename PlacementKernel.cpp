@@ -0,0 +1,184 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#include <cmath>
+#include <vector>
+
+#include "BongardPicture.hpp"
+#include "Configurations.hpp"
+#include "PlacementKernel.hpp"
+
+namespace bongard {
+
+namespace {
+
+/**
+ * @brief A bounding rectangle as the kernels store it.
+ */
+struct box {
+  int lx_;
+  int ly_;
+  int rx_;
+  int ry_;
+};
+
+/** Rectangle::isInside with the default margin. */
+inline bool boxInside(const box &a, const box &b) {
+  return a.lx_ >= b.lx_ + MARGIN && a.ly_ >= b.ly_ + MARGIN &&
+         a.rx_ <= b.rx_ - MARGIN && a.ry_ <= b.ry_ - MARGIN;
+}
+
+/** Rectangle::isOverlapped with the default margin. */
+inline bool boxOverlapped(const box &a, const box &b) {
+  return a.lx_ <= b.rx_ + MARGIN && a.rx_ + MARGIN >= b.lx_ &&
+         a.ly_ <= b.ry_ + MARGIN && a.ry_ + MARGIN >= b.ly_;
+}
+
+/**
+ * @brief The triangle geometry of every width that fits in the picture.
+ */
+template <int kBound>
+struct triangle_table {
+  triangle_table() {
+    for (int w = 0; w <= kBound; w++) {
+      height_[w] = triangleHeight(w);
+      inner_[w] = triangleInnerWidth(w);
+    }
+  }
+
+  int height_[kBound + 1];
+  int inner_[kBound + 1];
+};
+
+/**
+ * @brief Compute the bounding rectangles of the element \p spec as the
+ *        constructors of the elements do.
+ *
+ * @return False if the element exceeds the picture boundary.
+ */
+template <int kBound>
+inline bool elementBoxes(const element_spec &spec,
+                         const triangle_table<kBound> &tri, box *outer,
+                         box *inner) {
+  const int x = spec.x_;
+  const int y = spec.y_;
+  const int w = spec.size_;
+
+  // Rectangle::set makes every outer rectangle a w * w square.
+  outer->lx_ = x;
+  outer->ly_ = y;
+  outer->rx_ = x + w;
+  outer->ry_ = y + w;
+  if (outer->rx_ >= kBound || outer->ry_ >= kBound) return false;
+
+  if (spec.fig_ == 1) {
+    *inner = *outer;
+  } else if (spec.fig_ == 2) {
+    const int radius = w / 2;
+    const int lx = x + radius - std::sqrt(2) / 2.0 * radius;
+    const int ly = y + radius - std::sqrt(2) / 2.0 * radius;
+    const int iw = std::sqrt(2) * radius;
+    inner->lx_ = lx;
+    inner->ly_ = ly;
+    inner->rx_ = lx + iw;
+    inner->ry_ = ly + iw;
+  } else {
+    const int iw = tri.inner_[w];
+    inner->lx_ = x + (w - iw) / 2;
+    inner->ly_ = spec.fig_ == 4 ? y : y + tri.height_[w] - iw;
+    inner->rx_ = inner->lx_ + iw;
+    inner->ry_ = inner->ly_ + iw;
+  }
+  return true;
+}
+
+template <int kBound, int kMaxElems>
+bool placeElements(picture_params &p, unsigned size, long long budget,
+                   std::vector<element_spec> *specs) {
+  static const triangle_table<kBound> tri;
+
+  box placed[kMaxElems];
+  unsigned n = 0;
+  for (const element_spec &spec : *specs) {
+    box inner;
+    elementBoxes<kBound>(spec, tri, &placed[n++], &inner);
+  }
+  while (n < size) {
+    long long error_trial = 0;
+    while (true) {
+      p.stats_.element_trials_++;
+      element_spec spec;
+      spec.size_ = p.size_dist_(p.gen_);
+      spec.x_ = p.coord_dist_(p.gen_);
+      spec.y_ = p.coord_dist_(p.gen_);
+      spec.fig_ = p.type_dist_(p.gen_);
+
+      box outer, inner;
+      if (elementBoxes<kBound>(spec, tri, &outer, &inner)) {
+        // The loop has a constant trip count and no early exit, so that it
+        // is fully unrolled.
+        bool conflict = false;
+        for (int i = 0; i < kMaxElems; i++) {
+          conflict |= (static_cast<unsigned>(i) < n) &
+                      !boxInside(placed[i], inner) &
+                      boxOverlapped(placed[i], outer);
+        }
+        if (!conflict) {
+          placed[n++] = outer;
+          specs->push_back(spec);
+          break;
+        }
+      }
+      error_trial++;
+      if (error_trial > budget) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief A precompiled profile.
+ */
+struct kernel_profile {
+  int bound_;
+  int max_num_elems_;
+  placement_kernel kernel_;
+};
+
+/** The profiles, ordered by the maximum number of elements. */
+const kernel_profile kProfiles[] = {
+    {100, 8, &placeElements<100, 8>},
+    {100, 16, &placeElements<100, 16>},
+    {1000, 16, &placeElements<1000, 16>},
+    {1000, 64, &placeElements<1000, 64>},
+};
+
+}  // namespace
+
+placement_kernel selectPlacementKernel(int bound, int max_num_elems) {
+  for (const kernel_profile &profile : kProfiles) {
+    if (profile.bound_ == bound && max_num_elems <= profile.max_num_elems_) {
+      return profile.kernel_;
+    }
+  }
+  return NULL;
+}
+
+}  // namespace bongard
@@ -0,0 +1,98 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#ifndef PLACEMENT_KERNEL_HPP_
+#define PLACEMENT_KERNEL_HPP_
+
+#include <vector>
+
+namespace bongard {
+
+struct picture_params;
+
+/**
+ * @brief The drawn parameters of an element, see BongardPicture::createElement.
+ */
+struct element_spec {
+  int fig_;
+  int x_;
+  int y_;
+  int size_;
+};
+
+/**
+ * @brief A placement kernel draws the elements of a picture.
+ * @details It consumes the random numbers in the same order as
+ *          BongardPicture::createElement and accepts the same elements as
+ *          BongardPicture::isValid, so a picture does not depend on whether
+ *          a kernel is used.
+ *
+ * @param p Picture parameters.
+ * @param size The number of elements in the picture.
+ * @param budget The number of trials of each element.
+ * @param specs The elements already in the picture, to which the accepted
+ *              elements are appended.
+ * @return False if an element cannot be placed in \p budget trials.
+ */
+typedef bool (*placement_kernel)(picture_params &p, unsigned size,
+                                 long long budget,
+                                 std::vector<element_spec> *specs);
+
+/**
+ * @brief Select the kernel specialized for the picture \p bound and the
+ *        maximum number of elements \p max_num_elems.
+ *
+ * @return NULL if no precompiled profile fits; the generic placement in
+ *         BongardPicture is used then.
+ */
+placement_kernel selectPlacementKernel(int bound, int max_num_elems);
+
+/**
+ * @brief The height of a triangle of width \p w, i.e. ceil(w * sqrt(3) / 2).
+ */
+constexpr int triangleHeight(int w);
+
+namespace internal {
+
+constexpr long long triangleHeightSearch(long long w, long long lo,
+                                         long long hi) {
+  // The smallest h in [lo, hi] with 4h^2 >= 3w^2.
+  return lo >= hi ? lo
+                  : (4 * ((lo + hi) / 2) * ((lo + hi) / 2) >= 3 * w * w
+                         ? triangleHeightSearch(w, lo, (lo + hi) / 2)
+                         : triangleHeightSearch(w, (lo + hi) / 2 + 1, hi));
+}
+
+}  // namespace internal
+
+constexpr int triangleHeight(int w) {
+  return static_cast<int>(internal::triangleHeightSearch(w, 0, w));
+}
+
+/**
+ * @brief The width of the square inscribed in a triangle of width \p w.
+ */
+constexpr int triangleInnerWidth(int w) {
+  return w == 0 ? 0
+                : static_cast<int>(static_cast<long long>(triangleHeight(w)) *
+                                   w / (triangleHeight(w) + w));
+}
+
+}  // namespace bongard
+
+#endif /* PLACEMENT_KERNEL_HPP_ */
@@ -0,0 +1,79 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#include <boost/filesystem.hpp>
+#include <string>
+
+#include "Configurations.hpp"
+#include "OutputFile.hpp"
+#include "PrologFile.hpp"
+
+namespace bongard {
+
+namespace {
+
+/** The longest arguments of a fact: two IDs and four values. */
+const size_t kMaxArgsSize = 2 * 22 + 4 * 12 + 4;
+
+}  // namespace
+
+PrologFile::PrologFile(const boost::filesystem::path &path, io_mode io)
+    : file_(path, io), head_("("), first_prefix_('e') {}
+
+void PrologFile::setPredicate(const std::string &name, bool picture_first) {
+  head_ = name + "(";
+  first_prefix_ = picture_first ? 'p' : 'e';
+}
+
+void PrologFile::begin(id_type first) {
+  file_.reserve(head_.size() + kMaxArgsSize);
+  file_.put(head_);
+  file_.put(first_prefix_);
+  file_.append(first);
+}
+
+void PrologFile::write(id_type id) {
+  begin(id);
+  file_.put(").\n", 3);
+}
+
+void PrologFile::write(id_type first, id_type second) {
+  begin(first);
+  file_.put(",e", 2);
+  file_.append(second);
+  file_.put(").\n", 3);
+}
+
+void PrologFile::write(id_type id, const int *values, int num_values) {
+  begin(id);
+  for (int i = 0; i < num_values; i++) {
+    file_.put(',');
+    file_.append(values[i]);
+  }
+  file_.put(").\n", 3);
+}
+
+void PrologFile::writeLine(const std::string &line) {
+  file_.reserve(line.size() + 1);
+  file_.put(line);
+  file_.put('\n');
+}
+
+void PrologFile::close() { file_.close(); }
+
+}  // namespace bongard
@@ -0,0 +1,79 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#ifndef PROLOG_FILE_HPP_
+#define PROLOG_FILE_HPP_
+
+#include <boost/filesystem.hpp>
+#include <string>
+
+#include "Configurations.hpp"
+#include "OutputFile.hpp"
+
+namespace bongard {
+
+/**
+ * @brief A file of Prolog facts, such as "inside(e12,e7).".
+ * @details The objects are the constants e<ID> and the pictures p<ID>. The
+ *          write methods take the same rows as RelationFile and write them as
+ *          facts of the predicate set by setPredicate.
+ */
+class PrologFile {
+ public:
+  /**
+   * @brief Constructor.
+   *
+   * @param path The path of the file.
+   * @param io How the file is written.
+   */
+  explicit PrologFile(const boost::filesystem::path &path,
+                      io_mode io = kIOBuffered);
+
+  /**
+   * @param name The name of the predicate of the following facts.
+   * @param picture_first If the first argument is a picture; the other ID
+   *                      arguments are objects.
+   */
+  void setPredicate(const std::string &name, bool picture_first = false);
+
+  void write(id_type id);
+  void write(id_type first, id_type second);
+  void write(id_type id, const int *values, int num_values);
+
+  /**
+   * @brief Write a line as is, e.g., a directive.
+   */
+  void writeLine(const std::string &line);
+
+  /**
+   * @brief Flush and close the file.
+   */
+  void close();
+
+ private:
+  void begin(id_type first);
+
+  OutputFile file_;
+  /** "name(" of the predicate. */
+  std::string head_;
+  char first_prefix_;
+};
+
+}  // namespace bongard
+
+#endif /* PROLOG_FILE_HPP_ */
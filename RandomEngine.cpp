@@ -0,0 +1,56 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#include <cstdint>
+#include <random>
+
+#include "RandomEngine.hpp"
+
+namespace bongard {
+
+const char *engineName(engine_type type) {
+  switch (type) {
+    case kEngineMT19937:
+      return "mt19937";
+    case kEngineMT19937_64:
+      return "mt19937_64";
+    case kEngineSplitMix64:
+      return "splitmix64";
+    default:
+      return "unknown";
+  }
+}
+
+RandomEngine::RandomEngine(engine_type type, std::seed_seq &seq)
+    : type_(type), state_(0) {
+  switch (type_) {
+    case kEngineMT19937:
+      mt_.reset(new std::mt19937(seq));
+      break;
+    case kEngineMT19937_64:
+      mt64_.reset(new std::mt19937_64(seq));
+      break;
+    default: {
+      std::uint32_t words[2];
+      seq.generate(words, words + 2);
+      state_ = words[0] | static_cast<std::uint64_t>(words[1]) << 32;
+    }
+  }
+}
+
+}  // namespace bongard
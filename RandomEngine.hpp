@@ -0,0 +1,93 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#ifndef RANDOM_ENGINE_HPP_
+#define RANDOM_ENGINE_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <random>
+
+#include "DuplicateFilter.hpp"
+
+namespace bongard {
+
+/**
+ * @brief The random engines a picture may be drawn with.
+ */
+enum engine_type {
+  /** std::mt19937, the reference engine. */
+  kEngineMT19937 = 0,
+  /** The high 32 bits of std::mt19937_64. */
+  kEngineMT19937_64,
+  /** splitmix64, which is seeded in constant time. */
+  kEngineSplitMix64
+};
+
+/**
+ * @return The name of the engine \p type, as the option --rng takes it.
+ */
+const char *engineName(engine_type type);
+
+/**
+ * @brief A uniform random bit generator of 32-bit values backed by one of
+ *        the engines of engine_type.
+ * @details The engine is chosen at run time by a switch that is predicted
+ *          well, so that the distributions need not be templates over the
+ *          engine. With kEngineMT19937, it gives the values of std::mt19937.
+ */
+class RandomEngine {
+ public:
+  typedef std::uint32_t result_type;
+
+  /**
+   * @brief Constructor.
+   *
+   * @param type The engine.
+   * @param seq The seed of the engine.
+   */
+  RandomEngine(engine_type type, std::seed_seq &seq);
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return 0xffffffffu; }
+
+  inline result_type operator()() {
+    switch (type_) {
+      case kEngineMT19937:
+        return (*mt_)();
+      case kEngineMT19937_64:
+        return (*mt64_)() >> 32;
+      default:
+        state_ += 0x9e3779b97f4a7c15ULL;
+        return mixHash(state_) >> 32;
+    }
+  }
+
+  inline engine_type type() const { return type_; }
+
+ private:
+  engine_type type_;
+  /** Only the chosen engine is allocated and seeded. */
+  std::unique_ptr<std::mt19937> mt_;
+  std::unique_ptr<std::mt19937_64> mt64_;
+  std::uint64_t state_;
+};
+
+}  // namespace bongard
+
+#endif /* RANDOM_ENGINE_HPP_ */
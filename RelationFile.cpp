@@ -0,0 +1,146 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Configurations.hpp"
+#include "OutputFile.hpp"
+#include "RelationFile.hpp"
+
+namespace bongard {
+
+namespace {
+
+/** The longest row: two IDs and four values with their separators. */
+const size_t kMaxRowSize = 2 * 21 + 4 * 12;
+
+void printZone(FILE *file, const zone &z, int num_ids) {
+  fprintf(file, "%llu|%llu", z.min_[0], z.max_[0]);
+  if (num_ids > 1) {
+    fprintf(file, "|%llu|%llu\n", z.min_[1], z.max_[1]);
+  } else {
+    fprintf(file, "||\n");
+  }
+}
+
+}  // namespace
+
+zone::zone() : first_row_(0), rows_(0), offset_(0), bytes_(0) {
+  min_[0] = min_[1] = 0;
+  max_[0] = max_[1] = 0;
+}
+
+void zone::add(const id_type *ids, int num_ids, id_type bytes) {
+  for (int i = 0; i < num_ids; i++) {
+    if (rows_ == 0 || ids[i] < min_[i]) min_[i] = ids[i];
+    if (rows_ == 0 || ids[i] > max_[i]) max_[i] = ids[i];
+  }
+  rows_++;
+  bytes_ += bytes;
+}
+
+RelationFile::RelationFile(const boost::filesystem::path &dir,
+                           const std::string &name, int num_ids, io_mode io)
+    : name_(name),
+      num_ids_(num_ids),
+      file_(dir / name, io),
+      row_start_(0),
+      sorted_(true) {
+  last_[0] = last_[1] = 0;
+}
+
+void RelationFile::write(id_type id) {
+  file_.reserve(kMaxRowSize);
+  file_.append(id);
+  endRow(&id);
+}
+
+void RelationFile::write(id_type first, id_type second) {
+  const id_type ids[2] = {first, second};
+  file_.reserve(kMaxRowSize);
+  file_.append(first);
+  file_.put('|');
+  file_.append(second);
+  endRow(ids);
+}
+
+void RelationFile::write(id_type id, const int *values, int num_values) {
+  file_.reserve(kMaxRowSize);
+  file_.append(id);
+  for (int i = 0; i < num_values; i++) {
+    file_.put('|');
+    file_.append(values[i]);
+  }
+  endRow(&id);
+}
+
+void RelationFile::endRow(const id_type *ids) {
+  file_.put('\n');
+
+  const id_type end = file_.offset();
+  const id_type bytes = end - row_start_;
+  row_start_ = end;
+
+  if (total_.rows_ > 0) {
+    for (int i = 0; i < num_ids_; i++) {
+      if (ids[i] != last_[i]) {
+        sorted_ = sorted_ && ids[i] > last_[i];
+        break;
+      }
+    }
+  }
+  std::copy(ids, ids + num_ids_, last_);
+
+  if (total_.rows_ % ZONE_BLOCK_ROWS == 0) {
+    zone block;
+    block.first_row_ = total_.rows_;
+    block.offset_ = end - bytes;
+    blocks_.push_back(block);
+  }
+  blocks_.back().add(ids, num_ids_, bytes);
+  total_.add(ids, num_ids_, bytes);
+}
+
+void RelationFile::close() { file_.close(); }
+
+void writeZoneMaps(const boost::filesystem::path &dir,
+                   const std::vector<RelationFile *> &files) {
+  FILE *zonemap = fopen((dir / "zonemap").c_str(), "w");
+  FILE *blocks = fopen((dir / "zonemap_blocks").c_str(), "w");
+  for (const RelationFile *file : files) {
+    const zone &total = file->total();
+    fprintf(zonemap, "%s|%llu|%llu|%d|", file->name().c_str(), total.rows_,
+            total.bytes_, file->sorted() ? 1 : 0);
+    printZone(zonemap, total, file->numIds());
+
+    for (size_t i = 0; i < file->blocks().size(); i++) {
+      const zone &block = file->blocks()[i];
+      fprintf(blocks, "%s|%zu|%llu|%llu|%llu|%llu|", file->name().c_str(), i,
+              block.first_row_, block.rows_, block.offset_, block.bytes_);
+      printZone(blocks, block, file->numIds());
+    }
+  }
+  fclose(blocks);
+  fclose(zonemap);
+}
+
+}  // namespace bongard
@@ -0,0 +1,116 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#ifndef RELATION_FILE_HPP_
+#define RELATION_FILE_HPP_
+
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Configurations.hpp"
+#include "OutputFile.hpp"
+
+namespace bongard {
+
+/**
+ * @brief The row range, the byte range and the min/max of the ID columns of
+ *        a block of rows, or of a whole file.
+ */
+struct zone {
+  zone();
+
+  void add(const id_type *ids, int num_ids, id_type bytes);
+
+  id_type first_row_;
+  id_type rows_;
+  id_type offset_;
+  id_type bytes_;
+  id_type min_[2];
+  id_type max_[2];
+};
+
+/**
+ * @brief A '|'-separated text file of a relation, which keeps the zone maps
+ *        of its ID columns.
+ * @details Every row starts with one or two ID columns, which may be followed
+ *          by integer values. The file is split into blocks of
+ *          ZONE_BLOCK_ROWS rows.
+ */
+class RelationFile {
+ public:
+  /**
+   * @brief Constructor.
+   *
+   * @param dir The directory of the file.
+   * @param name The name of the relation, which is the file name.
+   * @param num_ids The number of ID columns (1 or 2).
+   * @param io How the file is written.
+   */
+  RelationFile(const boost::filesystem::path &dir, const std::string &name,
+               int num_ids, io_mode io = kIOBuffered);
+
+  void write(id_type id);
+  void write(id_type first, id_type second);
+  void write(id_type id, const int *values, int num_values);
+
+  /**
+   * @brief Flush and close the file.
+   */
+  void close();
+
+  inline const std::string &name() const { return name_; }
+  inline int numIds() const { return num_ids_; }
+  inline const zone &total() const { return total_; }
+  inline const std::vector<zone> &blocks() const { return blocks_; }
+
+  /**
+   * @return True if the rows are ordered by the ID columns.
+   */
+  inline bool sorted() const { return sorted_; }
+
+ private:
+  void endRow(const id_type *ids);
+
+  std::string name_;
+  int num_ids_;
+  OutputFile file_;
+  id_type row_start_;
+
+  zone total_;
+  std::vector<zone> blocks_;
+  bool sorted_;
+  id_type last_[2];
+};
+
+/**
+ * @brief Write the zone maps of the relation files of a fold.
+ * @details The file 'zonemap' gives
+ *          "relation|rows|bytes|sorted|min1|max1|min2|max2" per file and
+ *          'zonemap_blocks' gives
+ *          "relation|block|first_row|rows|offset|bytes|min1|max1|min2|max2"
+ *          per block, where the second ID column is empty for the relations
+ *          with one ID column.
+ */
+void writeZoneMaps(const boost::filesystem::path &dir,
+                   const std::vector<RelationFile *> &files);
+
+}  // namespace bongard
+
+#endif /* RELATION_FILE_HPP_ */
@@ -0,0 +1,88 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#include <algorithm>
+
+#include "BongardPicture.hpp"
+#include "SpatialGrid.hpp"
+
+namespace bongard {
+
+namespace {
+
+/** Floor division for possibly negative coordinates. */
+inline long long cellOf(long long coord, int cell_size) {
+  return coord >= 0 ? coord / cell_size : -((-coord + cell_size - 1) /
+                                            cell_size);
+}
+
+}  // namespace
+
+SpatialGrid::SpatialGrid(int cell_size)
+    : cell_size_(std::max(cell_size, 1)), max_extent_(0) {}
+
+SpatialGrid::cell_key SpatialGrid::cellKey(const BongardElement *elem) const {
+  const Point &lb = elem->getOuterBoundRect().getLeftBottom();
+  return key(cellOf(lb.x_, cell_size_), cellOf(lb.y_, cell_size_));
+}
+
+void SpatialGrid::insert(BongardElement *elem) {
+  const Rectangle &rect = elem->getOuterBoundRect();
+  const Point &lb = rect.getLeftBottom();
+  const Point &rt = rect.getRightTop();
+  max_extent_ = std::max(max_extent_, std::max(rt.x_ - lb.x_, rt.y_ - lb.y_));
+  cells_[cellKey(elem)].push_back(elem);
+}
+
+void SpatialGrid::remove(BongardElement *elem) {
+  // max_extent_ is kept: it only widens the queries.
+  std::unordered_map<cell_key, std::vector<BongardElement *>>::iterator it =
+      cells_.find(cellKey(elem));
+  if (it == cells_.end()) return;
+  std::vector<BongardElement *> &cell = it->second;
+  cell.erase(std::remove(cell.begin(), cell.end(), elem), cell.end());
+  if (cell.empty()) cells_.erase(it);
+}
+
+size_t SpatialGrid::memoryBytes() const {
+  // A cell is a node of the hash table, which also links the next node.
+  size_t bytes = sizeof(*this) + cells_.bucket_count() * sizeof(void *);
+  for (const std::pair<const cell_key, std::vector<BongardElement *>> &cell :
+       cells_) {
+    bytes += sizeof(void *) + sizeof(cell) +
+             cell.second.capacity() * sizeof(cell.second[0]);
+  }
+  return bytes;
+}
+
+void SpatialGrid::visitCells(const BongardElement *elem, int margin,
+                             long long *cx_lo, long long *cx_hi,
+                             long long *cy_lo, long long *cy_hi) const {
+  // A box overlaps the query box within the margin only if its left-bottom
+  // point is at most max_extent_ + margin to the left of/below the query box.
+  const Rectangle &rect = elem->getOuterBoundRect();
+  const Point &lb = rect.getLeftBottom();
+  const Point &rt = rect.getRightTop();
+  const long long reach = static_cast<long long>(max_extent_) + margin;
+  *cx_lo = cellOf(lb.x_ - reach, cell_size_);
+  *cx_hi = cellOf(static_cast<long long>(rt.x_) + margin, cell_size_);
+  *cy_lo = cellOf(lb.y_ - reach, cell_size_);
+  *cy_hi = cellOf(static_cast<long long>(rt.y_) + margin, cell_size_);
+}
+
+}  // namespace bongard
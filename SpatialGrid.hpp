@@ -0,0 +1,110 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#ifndef SPATIAL_GRID_HPP_
+#define SPATIAL_GRID_HPP_
+
+#include <unordered_map>
+#include <vector>
+
+#include "Configurations.hpp"
+
+namespace bongard {
+
+class BongardElement;
+
+/**
+ * @brief A uniform spatial hash of the elements of a picture.
+ * @details An element is stored in the cell of the left-bottom point of its
+ *          bounding box. With cells at least as large as the elements, a
+ *          query only visits the cells around the query box, so the cost of
+ *          a query does not depend on the number of elements in the picture.
+ */
+class SpatialGrid {
+ public:
+  /**
+   * @brief Constructor.
+   *
+   * @param cell_size The length of the side of a cell.
+   */
+  explicit SpatialGrid(int cell_size);
+
+  void insert(BongardElement *elem);
+
+  /**
+   * @brief Remove an inserted element.
+   */
+  void remove(BongardElement *elem);
+
+  /**
+   * @return The bytes held by the grid: its buckets, its cells and the
+   *         capacity of their vectors, without the overhead of the allocator.
+   */
+  size_t memoryBytes() const;
+
+  /**
+   * @brief Find the elements whose bounding boxes may be overlapped with the
+   *        bounding box of \p elem within a separate space of \p margin.
+   *
+   * @param elem The query element.
+   * @param margin The separate space.
+   * @param f Called with every candidate until it returns true.
+   * @return True if \p f returns true for a candidate.
+   */
+  template <typename Func>
+  bool anyCandidate(const BongardElement *elem, int margin, Func f) const;
+
+ private:
+  typedef long long cell_key;
+
+  cell_key cellKey(const BongardElement *elem) const;
+
+  inline cell_key key(long long cx, long long cy) const {
+    return (cx << 32) ^ (cy & 0xffffffffLL);
+  }
+
+  void visitCells(const BongardElement *elem, int margin, long long *cx_lo,
+                  long long *cx_hi, long long *cy_lo, long long *cy_hi) const;
+
+  const int cell_size_;
+  /** The largest width/height of an inserted bounding box. */
+  int max_extent_;
+  std::unordered_map<cell_key, std::vector<BongardElement *>> cells_;
+};
+
+template <typename Func>
+bool SpatialGrid::anyCandidate(const BongardElement *elem, int margin,
+                               Func f) const {
+  long long cx_lo, cx_hi, cy_lo, cy_hi;
+  visitCells(elem, margin, &cx_lo, &cx_hi, &cy_lo, &cy_hi);
+  for (long long cx = cx_lo; cx <= cx_hi; cx++) {
+    for (long long cy = cy_lo; cy <= cy_hi; cy++) {
+      std::unordered_map<cell_key, std::vector<BongardElement *>>::const_iterator
+          it = cells_.find(key(cx, cy));
+      if (it == cells_.end()) continue;
+      for (BongardElement *candidate : it->second) {
+        if (f(candidate)) return true;
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace bongard
+
+#endif /* SPATIAL_GRID_HPP_ */
@@ -0,0 +1,68 @@
+/**
+ * Copyright 2014 UW-Madison, Database Group
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Qiang Zeng <qzeng@cs.wisc.edu>
+ **/
+
+#ifndef THREAD_POOL_HPP_
+#define THREAD_POOL_HPP_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bongard {
+
+/**
+ * @brief A fixed set of worker threads running tasks in submission order.
+ */
+class ThreadPool {
+ public:
+  /**
+   * @brief Constructor.
+   *
+   * @param num_threads The number of worker threads (at least one).
+   */
+  explicit ThreadPool(int num_threads);
+
+  ~ThreadPool();
+
+  void submit(std::function<void()> task);
+
+  /**
+   * @brief Wait until every submitted task has finished.
+   */
+  void wait();
+
+  inline int size() const { return workers_.size(); }
+
+ private:
+  void run();
+
+  std::vector<std::thread> workers_;
+  std::deque<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable task_cv_;
+  std::condition_variable idle_cv_;
+  int running_;
+  bool stop_;
+};
+
+}  // namespace bongard
+
+#endif /* THREAD_POOL_HPP_ */